@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include "base/Noncopyable.h"
+
+/**
+ * 定长块的空闲链表 只有一个线程(所属的loop线程)分配 任何线程都可以释放
+ * 用于对象在一个线程中创建、最后一个引用却可能在别的线程中释放的场合 例如TcpConnection(经std::allocate_shared)
+ * 释放: CAS压入共享的空闲栈; 分配: 先取本线程的私有链表 空了再用一次exchange把共享栈整个取走
+ * 与MpscQueue的节点复用一样 整体取走不会有ABA问题
+ * 块的大小在第一次分配时确定 其他大小直接走operator new/delete 空闲块总数近似不超过maxFree
+ */
+class ConcurrentFreeList : noncopyable
+{
+public:
+    explicit ConcurrentFreeList(size_t maxFree = 1024) : local_(nullptr), shared_(nullptr), blockSize_(0), freeCount_(0), maxFree_(maxFree) {}
+    ~ConcurrentFreeList()
+    {
+        release(local_);
+        release(shared_.load(std::memory_order_acquire));
+    }
+
+    // 只能在所属的线程中调用
+    void *allocate(size_t size)
+    {
+        if (blockSize_.load(std::memory_order_relaxed) == 0 && size >= sizeof(Node))
+        {
+            blockSize_.store(size, std::memory_order_relaxed);
+        }
+        if (size == blockSize_.load(std::memory_order_relaxed))
+        {
+            if (!local_)
+            {
+                local_ = shared_.exchange(nullptr, std::memory_order_acquire);
+            }
+            if (local_)
+            {
+                Node *node = local_;
+                local_ = node->next;
+                freeCount_.fetch_sub(1, std::memory_order_relaxed);
+                return node;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    // 可以在任何线程中调用
+    void deallocate(void *p, size_t size)
+    {
+        if (size == blockSize_.load(std::memory_order_relaxed) && freeCount_.load(std::memory_order_relaxed) < maxFree_)
+        {
+            freeCount_.fetch_add(1, std::memory_order_relaxed);
+            Node *node = static_cast<Node *>(p);
+            node->next = shared_.load(std::memory_order_relaxed);
+            while (!shared_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    size_t freeCount() const { return freeCount_.load(std::memory_order_relaxed); }
+
+private:
+    struct Node
+    {
+        Node *next;
+    };
+
+    static void release(Node *node)
+    {
+        while (node)
+        {
+            Node *next = node->next;
+            ::operator delete(node);
+            node = next;
+        }
+    }
+
+    Node *local_;               // 只有所属线程访问
+    std::atomic<Node *> shared_; // 各线程释放的块
+    std::atomic<size_t> blockSize_;
+    std::atomic<size_t> freeCount_;
+    const size_t maxFree_;
+};
+
+// std::allocate_shared用的分配器 持有ConcurrentFreeList的引用计数: 对象(及其控制块)比所属的loop活得久时 空闲链表也还在
+template <typename T>
+class ConcurrentFreeListAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ConcurrentFreeListAllocator(std::shared_ptr<ConcurrentFreeList> list) noexcept : list_(std::move(list)) {}
+    template <typename U>
+    ConcurrentFreeListAllocator(const ConcurrentFreeListAllocator<U> &other) noexcept : list_(other.list()) {}
+
+    T *allocate(size_t n)
+    {
+        if (n == 1)
+        {
+            return static_cast<T *>(list_->allocate(sizeof(T)));
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        if (n == 1)
+        {
+            list_->deallocate(p, sizeof(T));
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    const std::shared_ptr<ConcurrentFreeList> &list() const noexcept { return list_; }
+
+    template <typename U>
+    bool operator==(const ConcurrentFreeListAllocator<U> &other) const noexcept { return list_ == other.list(); }
+    template <typename U>
+    bool operator!=(const ConcurrentFreeListAllocator<U> &other) const noexcept { return list_ != other.list(); }
+
+private:
+    std::shared_ptr<ConcurrentFreeList> list_;
+};
@@ -0,0 +1,178 @@
+#include "base/CpuAffinity.h"
+#include "base/Logger.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace
+{
+const int kMpolPreferred = 1; // linux/mempolicy.h 没有libnuma的头文件 在这里定义
+
+std::string readFirstLine(const std::string &path)
+{
+    std::string line;
+    FILE *fp = ::fopen(path.c_str(), "re");
+    if (fp)
+    {
+        char buf[1024];
+        if (::fgets(buf, sizeof buf, fp))
+        {
+            line = buf;
+        }
+        ::fclose(fp);
+    }
+    return line;
+}
+}
+
+int affinity::numCpus()
+{
+    long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+int affinity::numNumaNodes()
+{
+    std::vector<int> nodes = parseCpuList(readFirstLine("/sys/devices/system/node/online"));
+    return nodes.empty() ? 1 : nodes.back() + 1;
+}
+
+std::vector<int> affinity::cpusOfNode(int node)
+{
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+    std::vector<int> cpus = parseCpuList(readFirstLine(path));
+    if (cpus.empty() && node == 0)
+    { // 没有NUMA信息 全部CPU都当作节点0
+        for (int i = 0; i < numCpus(); ++i)
+        {
+            cpus.push_back(i);
+        }
+    }
+    return cpus;
+}
+
+int affinity::nodeOfCpu(int cpu)
+{
+    int nodes = numNumaNodes();
+    for (int node = 0; node < nodes; ++node)
+    {
+        for (int c : cpusOfNode(node))
+        {
+            if (c == cpu)
+            {
+                return node;
+            }
+        }
+    }
+    return 0;
+}
+
+std::vector<int> affinity::parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    const char *p = list.c_str();
+    while (*p >= '0' && *p <= '9')
+    {
+        char *end;
+        long first = ::strtol(p, &end, 10);
+        long last = first;
+        if (*end == '-')
+        {
+            last = ::strtol(end + 1, &end, 10);
+        }
+        for (long cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*end != ',')
+        {
+            break;
+        }
+        p = end + 1;
+    }
+    return cpus;
+}
+
+bool affinity::apply(const CpuPlacement &placement)
+{
+    bool ok = true;
+    std::vector<int> cpus = placement.cpus;
+    if (cpus.empty() && placement.numaNode >= 0)
+    {
+        cpus = cpusOfNode(placement.numaNode);
+    }
+    if (!cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int err = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+        if (err != 0)
+        {
+            errno = err;
+            LOG_SYSERR << "pthread_setaffinity_np";
+            ok = false;
+        }
+    }
+    if (placement.numaNode >= 0 && numNumaNodes() > 1)
+    { // 单节点的机器上没有意义 省掉一次系统调用
+        unsigned long mask = 1UL << placement.numaNode;
+        if (::syscall(SYS_set_mempolicy, kMpolPreferred, &mask, sizeof(mask) * 8) != 0)
+        {
+            LOG_SYSERR << "set_mempolicy node " << placement.numaNode;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+std::vector<CpuPlacement> affinity::spreadLoops(int numLoops)
+{
+    int nodes = numNumaNodes();
+    std::vector<std::vector<int>> cpusByNode;
+    for (int node = 0; node < nodes; ++node)
+    {
+        cpusByNode.push_back(cpusOfNode(node));
+    }
+
+    std::vector<CpuPlacement> placements;
+    std::vector<size_t> used(nodes, 0);
+    int node = 0;
+    while (static_cast<int>(placements.size()) < numLoops)
+    {
+        bool assigned = false;
+        for (int k = 0; k < nodes && !assigned; ++k, node = (node + 1) % nodes)
+        {
+            if (used[node] < cpusByNode[node].size())
+            {
+                CpuPlacement placement;
+                placement.cpus.push_back(cpusByNode[node][used[node]++]);
+                placement.numaNode = node;
+                placements.push_back(placement);
+                assigned = true;
+            }
+        }
+        if (!assigned)
+        { // 所有CPU都分完了 从头再来
+            if (used == std::vector<size_t>(nodes, 0))
+            {
+                placements.resize(numLoops); // 一个CPU都没有找到 不绑定
+                break;
+            }
+            used.assign(nodes, 0);
+        }
+    }
+    return placements;
+}
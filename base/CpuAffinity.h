@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * 线程绑核与NUMA节点 不依赖libnuma: 拓扑从/sys/devices/system/node读 内存策略直接调用set_mempolicy
+ * EventLoop线程在构造EventLoop之前调用apply(): 之后loop的对象、BlockPool、定时器池等都由这个线程第一次写入
+ * 按内核默认的first-touch策略分配在本节点上 再加上MPOL_PREFERRED 线程后来分配的内存也优先取本节点
+ */
+struct CpuPlacement
+{
+    std::vector<int> cpus; // 允许运行的CPU 为空时: 指定了numaNode就用该节点的全部CPU 否则不限制
+    int numaNode = -1;     // 内存优先从这个节点分配 -1表示不设置
+
+    bool empty() const { return cpus.empty() && numaNode < 0; }
+};
+
+namespace affinity
+{
+    int numCpus();      // 在线的CPU数
+    int numNumaNodes(); // 没有NUMA信息(单节点或者没有sysfs)时为1
+    std::vector<int> cpusOfNode(int node);
+    int nodeOfCpu(int cpu); // 找不到时为0
+
+    // "0-3,8,10-11" -> {0,1,2,3,8,10,11} 格式错误时返回已经解析出的部分
+    std::vector<int> parseCpuList(const std::string &list);
+
+    // 作用于调用线程 失败只记日志(容器里可能不允许绑核或设置内存策略) 返回是否全部成功
+    bool apply(const CpuPlacement &placement);
+
+    // 给numLoops个loop各分配一个CPU: 依次轮流取各个NUMA节点 节点内按CPU编号顺序 用完所有CPU后从头再来
+    // 这样loop平均分布在各个节点上 每个loop的内存都在自己的节点
+    std::vector<CpuPlacement> spreadLoops(int numLoops);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+#include "base/Noncopyable.h"
+
+/**
+ * 单线程使用的定长块空闲链表 给std::set/std::map这类逐个分配节点的容器复用节点
+ * 块的大小在第一次分配时确定 之后同样大小的释放进链表 下次直接取出; 其他大小(或者链表已满)直接走operator new/delete
+ * 多个容器的节点大小相同时可以共用一个FreeList FreeList必须比使用它的容器活得久
+ */
+class FreeList : noncopyable
+{
+public:
+    explicit FreeList(size_t maxFree = 4096) : head_(nullptr), blockSize_(0), freeCount_(0), maxFree_(maxFree) {}
+    ~FreeList()
+    {
+        while (head_)
+        {
+            Node *next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+    }
+
+    void *allocate(size_t size)
+    {
+        if (blockSize_ == 0 && size >= sizeof(Node))
+        {
+            blockSize_ = size;
+        }
+        if (size == blockSize_ && head_)
+        {
+            Node *node = head_;
+            head_ = node->next;
+            --freeCount_;
+            return node;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *p, size_t size)
+    {
+        if (size == blockSize_ && freeCount_ < maxFree_)
+        {
+            Node *node = static_cast<Node *>(p);
+            node->next = head_;
+            head_ = node;
+            ++freeCount_;
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    size_t freeCount() const { return freeCount_; }
+
+private:
+    struct Node
+    {
+        Node *next;
+    };
+
+    Node *head_;
+    size_t blockSize_;
+    size_t freeCount_;
+    const size_t maxFree_;
+};
+
+// 标准库容器的分配器 逐个分配的节点走FreeList 数组(n > 1)直接走operator new
+template <typename T>
+class FreeListAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit FreeListAllocator(FreeList *list) noexcept : list_(list) {}
+    template <typename U>
+    FreeListAllocator(const FreeListAllocator<U> &other) noexcept : list_(other.list()) {}
+
+    T *allocate(size_t n)
+    {
+        if (n == 1)
+        {
+            return static_cast<T *>(list_->allocate(sizeof(T)));
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        if (n == 1)
+        {
+            list_->deallocate(p, sizeof(T));
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    FreeList *list() const noexcept { return list_; }
+
+    template <typename U>
+    bool operator==(const FreeListAllocator<U> &other) const noexcept { return list_ == other.list(); }
+    template <typename U>
+    bool operator!=(const FreeListAllocator<U> &other) const noexcept { return list_ != other.list(); }
+
+private:
+    FreeList *list_;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 只能移动的std::function替代品 可调用对象不超过Capacity字节时直接放在对象内部 不分配堆内存
+ * libstdc++的std::function只能内联16字节 而EventLoop中常见的任务
+ * (bind一个成员函数指针 + this + std::string 或者 一个回调 + shared_ptr)都在64字节以内
+ * 超过容量(或者移动构造可能抛异常)的可调用对象退回到堆上分配
+ *
+ * 与std::function的区别: 不可拷贝; 不支持target()/target_type()
+ */
+template <typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    InplaceFunction() noexcept : ops_(nullptr) {}
+    InplaceFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same<D, InplaceFunction>::value &&
+                                          std::is_invocable_r<R, D &, Args...>::value>>
+    InplaceFunction(F &&f) : ops_(nullptr)
+    {
+        if (isEmpty(f))
+        {
+            return; // 与std::function一样 空的函数指针/std::function构造出空对象
+        }
+        if constexpr (kFitsInline<D>)
+        {
+            ::new (static_cast<void *>(&storage_)) D(std::forward<F>(f));
+            ops_ = &InlineOps<D>::ops;
+        }
+        else
+        {
+            *reinterpret_cast<D **>(&storage_) = new D(std::forward<F>(f));
+            ops_ = &HeapOps<D>::ops;
+        }
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(&other.storage_, &storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_)
+            {
+                ops_ = other.ops_;
+                ops_->move(&other.storage_, &storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same<D, InplaceFunction>::value &&
+                                          std::is_invocable_r<R, D &, Args...>::value>>
+    InplaceFunction &operator=(F &&f)
+    {
+        return *this = InplaceFunction(std::forward<F>(f));
+    }
+
+    InplaceFunction(const InplaceFunction &) = delete;
+    InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    // 与std::function一样是const的 但以非const左值调用保存的对象
+    R operator()(Args... args) const
+    {
+        if (!ops_)
+        {
+            throw std::bad_function_call();
+        }
+        return ops_->invoke(const_cast<Storage *>(&storage_), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    // 可调用对象是否放在了对象内部 用于测试和统计
+    bool isInline() const noexcept { return ops_ && ops_->isInline; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    typedef std::aligned_storage_t<Capacity, alignof(std::max_align_t)> Storage;
+
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*move)(void *from, void *to) noexcept; // 移动到to 并析构from
+        void (*destroy)(void *storage) noexcept;
+        bool isInline;
+    };
+
+    template <typename D>
+    static constexpr bool kFitsInline = sizeof(D) <= Capacity &&
+                                        alignof(D) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible<D>::value;
+
+    template <typename D>
+    struct InlineOps
+    {
+        static R invoke(void *storage, Args &&...args)
+        {
+            return std::invoke(*static_cast<D *>(storage), std::forward<Args>(args)...);
+        }
+        static void move(void *from, void *to) noexcept
+        {
+            D *src = static_cast<D *>(from);
+            ::new (to) D(std::move(*src));
+            src->~D();
+        }
+        static void destroy(void *storage) noexcept { static_cast<D *>(storage)->~D(); }
+        static constexpr Ops ops = {&invoke, &move, &destroy, true};
+    };
+
+    template <typename D>
+    struct HeapOps // storage_中只放一个指向堆上对象的指针
+    {
+        static R invoke(void *storage, Args &&...args)
+        {
+            return std::invoke(**static_cast<D **>(storage), std::forward<Args>(args)...);
+        }
+        static void move(void *from, void *to) noexcept
+        {
+            *static_cast<D **>(to) = *static_cast<D **>(from);
+        }
+        static void destroy(void *storage) noexcept { delete *static_cast<D **>(storage); }
+        static constexpr Ops ops = {&invoke, &move, &destroy, false};
+    };
+
+    template <typename F>
+    static bool isEmpty(const F &f)
+    {
+        if constexpr (std::is_pointer<F>::value || std::is_member_pointer<F>::value)
+        {
+            return f == nullptr;
+        }
+        else
+        {
+            return isEmptyFunction(f);
+        }
+    }
+
+    template <typename Sig>
+    static bool isEmptyFunction(const std::function<Sig> &f) { return !f; }
+    template <typename F>
+    static bool isEmptyFunction(const F &) { return false; }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops *ops_;
+};
+
+// EventLoop任务 定时器回调 Channel事件回调使用的类型
+typedef InplaceFunction<void()> InplaceTask;
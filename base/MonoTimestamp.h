@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "base/Timestamp.h"
+
+/**
+ * 单调时钟(CLOCK_MONOTONIC)上的时刻 微秒 起点是开机 只能用来比较先后和计算间隔 不能换算成日期
+ * 定时器的调度都用它: 修改系统时间(NTP跳变 date -s)不会让定时器提前或推迟 timerfd也可以直接按绝对时刻设置
+ * 没有用CLOCK_MONOTONIC_COARSE: 它的精度是一个jiffy(1~10ms) 比时间轮的1ms tick还粗
+ * 两者都走vDSO 不陷入内核 省下的读时钟次数靠EventLoop::monoNow()每轮只读一次
+ */
+class MonoTimestamp
+{
+private:
+    int64_t microSeconds_;
+
+public:
+    MonoTimestamp() : microSeconds_(0) {} // 无效的时刻
+    explicit MonoTimestamp(int64_t microSeconds) : microSeconds_(microSeconds) {}
+
+    bool valid() const { return microSeconds_ > 0; }
+    int64_t microSeconds() const { return microSeconds_; }
+
+    static MonoTimestamp now()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return MonoTimestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+    }
+    static MonoTimestamp invalid() { return MonoTimestamp(); }
+
+    // 墙上时间换算到单调时钟: 按与现在的差值平移 之后系统时间再怎么调整都不影响
+    static MonoTimestamp fromWallTime(Timestamp when)
+    {
+        return MonoTimestamp(now().microSeconds_ + (when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch()));
+    }
+
+    bool operator<(MonoTimestamp rhs) const { return microSeconds_ < rhs.microSeconds_; }
+    bool operator==(MonoTimestamp rhs) const { return microSeconds_ == rhs.microSeconds_; }
+    bool operator<=(MonoTimestamp rhs) const { return microSeconds_ <= rhs.microSeconds_; }
+    bool operator>(MonoTimestamp rhs) const { return microSeconds_ > rhs.microSeconds_; }
+    bool operator>=(MonoTimestamp rhs) const { return microSeconds_ >= rhs.microSeconds_; }
+    bool operator!=(MonoTimestamp rhs) const { return microSeconds_ != rhs.microSeconds_; }
+};
+
+inline double timeDifference(MonoTimestamp high, MonoTimestamp low)
+{
+    int64_t diff = high.microSeconds() - low.microSeconds();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+inline MonoTimestamp addTime(MonoTimestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return MonoTimestamp(timestamp.microSeconds() + delta);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+#include "base/Noncopyable.h"
+
+/**
+ * 无锁的多生产者单消费者队列(Dmitry Vyukov的MPSC队列)
+ * 生产者push只有一次原子exchange和一次store 互相之间不会阻塞 也不会被消费者阻塞
+ * 只允许一个线程pop 消费者持有一个哑节点 所以队列永远不为空链表
+ *
+ * 注意: 生产者在exchange之后、链接next之前被挂起时 消费者会暂时看不到这个元素及其后的元素(pop返回false)
+ * 需要确切数量的调用方(例如EventLoop)自己维护计数 计数到了但是pop失败时说明链接还没完成 稍等再取即可
+ *
+ * 节点复用: 消费者pop释放的节点压入同一T类型共享的全局空闲栈(CAS压栈)
+ * 生产者从线程局部缓存取节点 缓存空了用一次exchange把整个全局空闲栈取走
+ * 整体取走不会有ABA问题 稳定状态下push/pop都不再分配内存 空闲节点总数近似不超过kMaxPooledNodes
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue()
+    {
+        T ignored;
+        while (pop(&ignored))
+        {
+        }
+        recycle(tail_);
+    }
+
+    // 任意线程调用
+    void push(T value)
+    {
+        Node *node = allocate(std::move(value));
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel); // 串行化所有生产者
+        prev->next.store(node, std::memory_order_release);          // 把新节点挂到链表上 消费者此时才能看到它
+    }
+
+    // 只能在消费者线程调用 没有可取的元素时返回false
+    bool pop(T *value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        *value = std::move(next->value);
+        tail_ = next; // next成为新的哑节点
+        recycle(tail);
+        return true;
+    }
+
+    // 只是一个近似值 只能在消费者线程调用
+    bool empty() const
+    {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() : next(nullptr) {}
+        explicit Node(T &&v) : next(nullptr), value(std::move(v)) {}
+        std::atomic<Node *> next;
+        T value;
+    };
+
+    static const size_t kMaxPooledNodes = 4096;
+
+    // 全局空闲栈 平凡析构 程序退出时不会早于仍在使用它的静态队列被销毁
+    static std::atomic<Node *> &freeList()
+    {
+        static std::atomic<Node *> head(nullptr);
+        return head;
+    }
+    static std::atomic<size_t> &pooledCount() // 全局空闲栈与各线程缓存中的节点数 近似值
+    {
+        static std::atomic<size_t> count(0);
+        return count;
+    }
+
+    // 生产者线程的节点缓存 线程退出时释放
+    struct LocalCache
+    {
+        Node *head = nullptr;
+        size_t taken = 0; // 上次同步pooledCount以来从缓存中取走的节点数
+        ~LocalCache()
+        {
+            while (head)
+            {
+                Node *node = head;
+                head = node->next.load(std::memory_order_relaxed);
+                delete node;
+                ++taken;
+            }
+            pooledCount().fetch_sub(taken, std::memory_order_relaxed);
+        }
+    };
+    static LocalCache &localCache()
+    {
+        static thread_local LocalCache cache;
+        return cache;
+    }
+
+    static Node *allocate(T &&value)
+    {
+        LocalCache &cache = localCache();
+        if (!cache.head)
+        {
+            cache.head = freeList().exchange(nullptr, std::memory_order_acquire);
+            pooledCount().fetch_sub(cache.taken, std::memory_order_relaxed);
+            cache.taken = 0;
+        }
+        Node *node = cache.head;
+        if (!node)
+        {
+            return new Node(std::move(value));
+        }
+        cache.head = node->next.load(std::memory_order_relaxed);
+        ++cache.taken;
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->value = std::move(value);
+        return node;
+    }
+
+    // 节点中的value已经被移走
+    static void recycle(Node *node)
+    {
+        if (pooledCount().load(std::memory_order_relaxed) >= kMaxPooledNodes)
+        {
+            delete node;
+            return;
+        }
+        pooledCount().fetch_add(1, std::memory_order_relaxed);
+        std::atomic<Node *> &list = freeList();
+        Node *head = list.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(head, std::memory_order_relaxed);
+        } while (!list.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    alignas(64) std::atomic<Node *> head_; // 生产者端 与消费者端分开在不同的cache line上
+    alignas(64) Node *tail_;                // 消费者端
+};
@@ -0,0 +1,35 @@
+#include "base/CpuAffinity.h"
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+#include <thread>
+
+int main()
+{
+    assert((affinity::parseCpuList("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    assert(affinity::parseCpuList("").empty());
+
+    printf("cpus %d numa nodes %d\n", affinity::numCpus(), affinity::numNumaNodes());
+    for (int node = 0; node < affinity::numNumaNodes(); ++node)
+    {
+        printf("node %d:", node);
+        for (int cpu : affinity::cpusOfNode(node))
+        {
+            printf(" %d", cpu);
+        }
+        printf("\n");
+    }
+
+    std::vector<CpuPlacement> placements = affinity::spreadLoops(affinity::numCpus() + 1);
+    for (size_t i = 0; i < placements.size(); ++i)
+    {
+        std::thread t([&placements, i]()
+                      {
+                          bool ok = affinity::apply(placements[i]);
+                          printf("loop %zu -> cpu %d node %d: %s, running on cpu %d\n", i, placements[i].cpus.at(0),
+                                 placements[i].numaNode, ok ? "applied" : "failed", sched_getcpu());
+                      });
+        t.join();
+    }
+    return 0;
+}
@@ -29,25 +29,37 @@ Acceptor::~Acceptor()
 }
 
 // 接受新客户端连接，并且以负载均衡的选择方式选择一个sub EventLoop，并把这个新连接分发到这个subEventLoop上
+// 一次可读事件把backlog中的连接尽量取完(最多kMaxAcceptsPerRead个) 而不是每个连接都经过一次epoll_wait
 void Acceptor::handleRead()
 {
     loop_->assertInLoopThread();
-    InetAddress peerAddr;
-    int confd = acceptSocket_.accept(&peerAddr);
-    if (confd >= 0)
+    int accepted = 0;
+    for (int attempt = 0; attempt < kMaxAcceptsPerRead; ++attempt)
     {
-        if (newconnectionCallback_)
+        InetAddress peerAddr;
+        int confd = acceptSocket_.accept(&peerAddr);
+        if (confd >= 0)
         {
-            newconnectionCallback_(confd, peerAddr);
+            ++accepted;
+            if (newconnectionCallback_)
+            {
+                newconnectionCallback_(confd, peerAddr);
+            }
+            else
+            {
+                sockets::close(confd);
+            }
+            continue;
         }
-        else
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
         {
-            sockets::close(confd);
+            break; // backlog已经取空
         }
-    }
-    else
-    {   //系统以及没有足够的空间为新来的连接分配conn_fd了 那么用idleFd接收这个连接并马上关闭 
-        LOG_SYSERR << "in Acceptor::handleRead";
+        if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO || errno == EPERM)
+        {
+            continue; // 只影响这一个连接
+        }
+        //系统以及没有足够的空间为新来的连接分配conn_fd了 那么用idleFd接收这个连接并马上关闭
         if (errno == EMFILE)
         {
             close(idleFd_);
@@ -55,6 +67,11 @@ void Acceptor::handleRead()
             close(idleFd_);
             idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
         }
+        break;
+    }
+    if (accepted > 0 && acceptBatchCallback_)
+    {
+        acceptBatchCallback_();
     }
 }
 
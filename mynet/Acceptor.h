@@ -11,6 +11,9 @@ class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    using AcceptBatchCallback = std::function<void()>;
+    // 一次可读事件最多调用accept的次数 剩下的(电平触发)下一轮poll再取 不让连接风暴独占loop
+    static const int kMaxAcceptsPerRead = 128;
 
 private:
     void handleRead();
@@ -18,6 +21,7 @@ private:
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback newconnectionCallback_;
+    AcceptBatchCallback acceptBatchCallback_;
     bool listening_;
     int idleFd_;
 
@@ -29,8 +33,14 @@ public:
     {
         newconnectionCallback_ = cb;
     };
+    //一次可读事件中accept到的连接都回调完newconnectionCallback_之后调用 用来把这一批连接合并分发
+    void setAcceptBatchCallback(const AcceptBatchCallback &cb)
+    {
+        acceptBatchCallback_ = cb;
+    }
 
     void listen();
 
     bool listening() const { return listening_; }
+    EventLoop *getLoop() const { return loop_; }
 };
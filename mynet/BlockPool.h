@@ -0,0 +1,108 @@
+#pragma once
+/**
+ * 固定大小(16KB)内存块的空闲链表 每个EventLoop一个 被ChainBuffer和OutputQueue使用
+ * 块在同一个loop的各个连接之间循环使用 连接的缓冲区再大也只是块的个数变多 不会出现大块连续内存的重新分配
+ * 不是线程安全的 只能在所属loop线程中使用
+ */
+#include "base/Noncopyable.h"
+
+#include <vector>
+#include <assert.h>
+#include <stddef.h>
+
+class BlockPool : noncopyable
+{
+public:
+    static constexpr size_t kBlockSize = 16 * 1024;
+    static constexpr size_t kDefaultMaxFreeBlocks = 256; // 空闲块最多保留4MB 超出的直接释放
+
+    explicit BlockPool(size_t maxFreeBlocks = kDefaultMaxFreeBlocks) : maxFreeBlocks_(maxFreeBlocks), inUse_(0) {}
+
+    ~BlockPool()
+    {
+        assert(inUse_ == 0);
+        for (char *block : free_)
+        {
+            delete[] block;
+        }
+    }
+
+    char *allocate()
+    {
+        ++inUse_;
+        if (free_.empty())
+        {
+            return new char[kBlockSize];
+        }
+        char *block = free_.back();
+        free_.pop_back();
+        return block;
+    }
+
+    void deallocate(char *block)
+    {
+        assert(inUse_ > 0);
+        --inUse_;
+        if (free_.size() < maxFreeBlocks_)
+        {
+            free_.push_back(block);
+        }
+        else
+        {
+            delete[] block;
+        }
+    }
+
+    size_t freeBlocks() const { return free_.size(); }
+    size_t blocksInUse() const { return inUse_; }
+
+private:
+    std::vector<char *> free_;
+    size_t maxFreeBlocks_;
+    size_t inUse_;
+};
+
+// 持有BlockPool中的一个块 析构时归还 只能移动
+class PooledBlock
+{
+public:
+    PooledBlock() : pool_(nullptr), data_(nullptr) {}
+    explicit PooledBlock(BlockPool *pool) : pool_(pool), data_(pool->allocate()) {}
+    PooledBlock(PooledBlock &&other) noexcept : pool_(other.pool_), data_(other.data_)
+    {
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+    }
+    PooledBlock &operator=(PooledBlock &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            pool_ = other.pool_;
+            data_ = other.data_;
+            other.pool_ = nullptr;
+            other.data_ = nullptr;
+        }
+        return *this;
+    }
+    PooledBlock(const PooledBlock &) = delete;
+    PooledBlock &operator=(const PooledBlock &) = delete;
+    ~PooledBlock() { reset(); }
+
+    char *data() const { return data_; }
+    explicit operator bool() const { return data_ != nullptr; }
+
+    void reset()
+    {
+        if (data_)
+        {
+            pool_->deallocate(data_);
+            pool_ = nullptr;
+            data_ = nullptr;
+        }
+    }
+
+private:
+    BlockPool *pool_;
+    char *data_;
+};
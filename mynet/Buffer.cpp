@@ -1,21 +1,45 @@
 #include "Buffer.h"
 #include "mynet/SocketsOps.h"
 #include <errno.h>
+#include <sys/ioctl.h>
 #include <sys/uio.h>
 // 类的静态变量 类外声明一次分配内存空间
 const char Buffer::kCRLF[] = "\r\n";
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
+const size_t Buffer::kMaxReadSize;
+const size_t Buffer::kShrinkThreshold;
+std::atomic<int64_t> Buffer::totalExtraBufBytes_(0);
 
 
-//在栈上分配64KB的空间 
+//在栈上分配64KB的空间 只在预留的可写空间不够时才会用到
 ssize_t Buffer::readFd(int fd, int *savedErrno) 
 {//从fd的内核缓冲区读取收到的数据
-    char extraBuf[65536];//64KB的BUF 足够大 不用调用ioctl()系统调用 询问需要读多大的数据
+    size_t want = readEstimate_;
+    if (lastReadFull_)
+    { // 上次读满了 问一下内核现在有多少数据 一次预留够
+        int available = 0;
+        if (::ioctl(fd, FIONREAD, &available) == 0 && available > 0)
+        {
+            want = std::max(want, static_cast<size_t>(available));
+        }
+    }
+    want = std::min(want, kMaxReadSize);
+    if (readableBytes() == 0 && buffer_.size() > kShrinkThreshold && buffer_.size() > 4 * (want + kCheapPrepend))
+    { // 连接空闲下来了 把之前大流量时撑大的缓冲区还回去
+        retrieveAll();
+        shrink(std::max(want, kInitialSize));
+    }
+    if (writableBytes() < want)
+    {
+        ensureWritaleBytes(want); // 一次扩到位 内核直接写进来 而不是先进extraBuf再append
+    }
+
+    char extraBuf[65536];//64KB的BUF 估计偏小时兜底 不用为了一次突发把Buffer撑大
     iovec vec[2];
     const size_t writeable = writableBytes();
 
-    vec[0].iov_base = begin() + readerIndex_; //第一块缓冲区
+    vec[0].iov_base = beginWrite(); //第一块缓冲区 接在已有数据之后
     vec[0].iov_len = writeable;
     vec[1].iov_base = extraBuf;  //第二块缓冲区
     vec[1].iov_len = sizeof extraBuf;
@@ -25,13 +49,18 @@ ssize_t Buffer::readFd(int fd, int *savedErrno)
     if (n < 0)
     {
         *savedErrno = errno;
+        return n;
     }
-    else if (n <= writeable)
+    else if (static_cast<size_t>(n) <= writeable)
     {
         writerIndex_ += n;
     }else{
         writerIndex_ = buffer_.size();
         append(extraBuf,n - writeable);
+        extraBufBytes_ += n - writeable;
+        totalExtraBufBytes_.fetch_add(n - writeable, std::memory_order_relaxed);
     }
+    lastReadFull_ = static_cast<size_t>(n) >= writeable && n > 0;
+    readEstimate_ = static_cast<uint32_t>((readEstimate_ * 7 + static_cast<size_t>(n)) / 8); // 1/8权重的滑动平均
     return n;
 }
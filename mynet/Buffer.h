@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mynet/Endian.h" //包含了主机字节序和网络字节序的转化函数
+#include <atomic>
 #include <vector>
 #include <algorithm>
 #include <assert.h>
@@ -17,8 +18,11 @@ class Buffer
 public:
     static const size_t kCheapPrepend = 8; // 预留的空间
     static const size_t kInitialSize = 1024;
+    static const size_t kMaxReadSize = 1024 * 1024;        // readFd一次预留的可写空间上限
+    static const size_t kShrinkThreshold = 64 * 1024;      // 超过这个容量 连接空闲下来(缓冲区读空 估计值变小)时缩回去
     explicit Buffer(size_t initialSize = kInitialSize) : buffer_(initialSize + kCheapPrepend),
-                                                         readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend)
+                                                         readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend),
+                                                         readEstimate_(0), lastReadFull_(false), extraBufBytes_(0)
     {
 
         assert(readableBytes() == 0);
@@ -315,7 +319,14 @@ public:
         return buffer_.capacity();
     }
 
-    ssize_t readFd(int fd, int *savedErrno); // 。利用readfd()，在栈上开辟一块65536字节额外缓冲区，利用readv()来读。
+    // 利用readv()来读 第二块是栈上的64KB额外缓冲区 读到其中的数据需要再append(拷贝)一次
+    // 按最近读取大小的滑动平均(上一次读满时再用FIONREAD查询)预留可写空间 让内核直接写进Buffer 尽量不用额外缓冲区
+    ssize_t readFd(int fd, int *savedErrno);
+
+    // 经由栈上额外缓冲区拷贝进来的字节数 本Buffer的累计值/整个进程的累计值
+    size_t extraBufBytes() const { return extraBufBytes_; }
+    static int64_t totalExtraBufBytes() { return totalExtraBufBytes_.load(std::memory_order_relaxed); }
+    size_t readEstimate() const { return readEstimate_; }
 
 private:
     char *begin() // buffer的最开始位置
@@ -350,5 +361,9 @@ private:
     std::vector<char> buffer_;
     size_t readerIndex_; // 可读区域的开始下标
     size_t writerIndex_; // 可写区域的开始下标
+    uint32_t readEstimate_; // readFd每次读到字节数的滑动平均
+    bool lastReadFull_;     // 上一次readFd把预留的可写空间读满了 内核中可能还有更多数据
+    size_t extraBufBytes_;
+    static std::atomic<int64_t> totalExtraBufBytes_;
     static const char kCRLF[];
 };
\ No newline at end of file
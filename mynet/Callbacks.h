@@ -1,5 +1,6 @@
 #pragma once
 #include "base/Timestamp.h"
+#include "base/InplaceFunction.h"
 #include <memory>
 #include <chrono>
 #include <functional>
@@ -21,7 +22,7 @@ inline T* get_pointer(const std::unique_ptr<T>& ptr)
 class Buffer;
 class TcpConnection;
 typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
-typedef std::function<void()> TimerCallback;
+typedef InplaceTask TimerCallback; // 只能移动 捕获不超过64字节时不分配内存
 typedef std::function<void (const TcpConnectionPtr&)> ConnectionCallback;
 typedef std::function<void (const TcpConnectionPtr&)> CloseCallback;
 typedef std::function<void (const TcpConnectionPtr&)> WriteCompleteCallback;
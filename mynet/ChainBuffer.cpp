@@ -0,0 +1,157 @@
+#include "mynet/ChainBuffer.h"
+#include "mynet/SocketsOps.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+const int ChainBuffer::kMaxReadBlocks;
+
+void ChainBuffer::retrieve(size_t len)
+{
+    assert(len <= readable_);
+    readable_ -= len;
+    while (len > 0)
+    {
+        Segment &front = segments_.front();
+        size_t n = std::min(len, front.end - front.begin);
+        front.begin += n;
+        len -= n;
+        if (front.begin == front.end)
+        {
+            if (segments_.size() > 1)
+            {
+                segments_.pop_front(); // 读空的块还给BlockPool
+            }
+            else
+            {
+                front.begin = front.end = 0; // 最后一块留着继续写 免得马上又要申请
+            }
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    segments_.clear();
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    assert(len <= readable_);
+    std::string result;
+    result.reserve(len);
+    size_t remaining = len;
+    for (auto it = segments_.begin(); remaining > 0; ++it)
+    {
+        size_t n = std::min(remaining, it->end - it->begin);
+        result.append(it->block.data() + it->begin, n);
+        remaining -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (tailWritable() == 0)
+        {
+            segments_.emplace_back(pool_);
+        }
+        Segment &tail = segments_.back();
+        size_t n = std::min(len, BlockPool::kBlockSize - tail.end);
+        memcpy(tail.block.data() + tail.end, data, n);
+        tail.end += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+int ChainBuffer::readableIovecs(iovec *vec, int maxVecs) const
+{
+    int count = 0;
+    for (auto it = segments_.begin(); it != segments_.end() && count < maxVecs; ++it)
+    {
+        if (it->end > it->begin)
+        {
+            vec[count].iov_base = it->block.data() + it->begin;
+            vec[count].iov_len = it->end - it->begin;
+            ++count;
+        }
+    }
+    return count;
+}
+
+ssize_t ChainBuffer::readFd(int fd, int *savedErrno)
+{
+    iovec vec[kMaxReadBlocks + 1];
+    int iovcnt = 0;
+    const size_t writable = tailWritable();
+    if (writable > 0)
+    {
+        vec[iovcnt].iov_base = segments_.back().block.data() + segments_.back().end;
+        vec[iovcnt].iov_len = writable;
+        ++iovcnt;
+    }
+    // 先挂上新块 读完再把没用上的摘掉
+    const size_t oldBlocks = segments_.size();
+    for (int i = 0; i < kMaxReadBlocks; ++i)
+    {
+        segments_.emplace_back(pool_);
+        vec[iovcnt].iov_base = segments_.back().block.data();
+        vec[iovcnt].iov_len = BlockPool::kBlockSize;
+        ++iovcnt;
+    }
+
+    const ssize_t n = sockets::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+    size_t remaining = n > 0 ? static_cast<size_t>(n) : 0;
+    readable_ += remaining;
+    if (writable > 0)
+    {
+        size_t used = std::min(remaining, writable);
+        segments_[oldBlocks - 1].end += used;
+        remaining -= used;
+    }
+    size_t keep = oldBlocks;
+    for (size_t i = oldBlocks; i < segments_.size() && remaining > 0; ++i, ++keep)
+    {
+        size_t used = std::min(remaining, BlockPool::kBlockSize);
+        segments_[i].end = used;
+        remaining -= used;
+    }
+    while (segments_.size() > keep)
+    {
+        segments_.pop_back();
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *savedErrno)
+{
+    iovec vec[IOV_MAX];
+    int iovcnt = readableIovecs(vec, IOV_MAX);
+    if (iovcnt == 0)
+    {
+        return 0;
+    }
+    ssize_t n = sockets::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+    else
+    {
+        retrieve(n);
+    }
+    return n;
+}
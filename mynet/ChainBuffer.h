@@ -0,0 +1,72 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "mynet/BlockPool.h"
+
+#include <deque>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * 由BlockPool中固定大小的块串起来的缓冲区 接口与Buffer保持一致(peek/retrieve/append/readFd)
+ * 与Buffer的区别:
+ *   不会整体扩容 也没有makeSpace的搬移 积压再多的数据也只是多挂几个块 读空的块立即还给loop的BlockPool
+ *   可读数据不一定连续: peek()只返回首块中的部分 长度由peekableBytes()给出; 需要全部数据时用readableIovecs()
+ * 只能在BlockPool所属的loop线程中使用
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    static const int kMaxReadBlocks = 4; // readFd一次最多准备的新块数 与Buffer::readFd的64KB栈上缓冲区相当
+
+    explicit ChainBuffer(BlockPool *pool) : pool_(pool), readable_(0) {}
+
+    size_t readableBytes() const { return readable_; }
+    size_t blockCount() const { return segments_.size(); }
+
+    // 首块中的可读数据 没有数据时返回nullptr
+    const char *peek() const
+    {
+        return segments_.empty() ? nullptr : segments_.front().block.data() + segments_.front().begin;
+    }
+    size_t peekableBytes() const
+    {
+        return segments_.empty() ? 0 : segments_.front().end - segments_.front().begin;
+    }
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAsString(size_t len);
+    std::string retrieveAllAsString() { return retrieveAsString(readable_); }
+
+    void append(const char *data, size_t len);
+    void append(const void *data, size_t len) { append(static_cast<const char *>(data), len); }
+    void append(const std::string &str) { append(str.data(), str.size()); }
+
+    // 可读数据的iovec视图 最多maxVecs段 返回填写的段数 可以直接交给writev
+    int readableIovecs(iovec *vec, int maxVecs) const;
+
+    // readv读入尾块的剩余空间和若干新块 没用上的新块立即归还
+    ssize_t readFd(int fd, int *savedErrno);
+    // writev写出尽可能多的数据 写出的部分被retrieve
+    ssize_t writeFd(int fd, int *savedErrno);
+
+private:
+    struct Segment
+    {
+        explicit Segment(BlockPool *pool) : block(pool), begin(0), end(0) {}
+        PooledBlock block;
+        size_t begin; // 块内可读区域[begin, end)
+        size_t end;
+    };
+
+    size_t tailWritable() const
+    {
+        return segments_.empty() ? 0 : BlockPool::kBlockSize - segments_.back().end;
+    }
+
+    BlockPool *pool_;
+    std::deque<Segment> segments_;
+    size_t readable_;
+};
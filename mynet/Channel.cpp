@@ -8,6 +8,8 @@
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = POLLIN | POLLPRI; // POLLPRI 紧迫数据
 const int Channel::KWriteEvent = POLLOUT;
+const int Channel::kRecvCompleteEvent = 1 << 24; // 不与任何POLL*/EPOLL*标志重叠
+const int Channel::kSendCompleteEvent = 1 << 25;
 
 Channel::Channel(EventLoop *loop, int fd) : loop_(loop),
                                             fd_(fd),
@@ -15,9 +17,15 @@ Channel::Channel(EventLoop *loop, int fd) : loop_(loop),
                                             revents_(0),
                                             index_(-1),
                                             logHup_(true),
+                                            edgeTriggered_(false),
+                                            committedEvents_(kNoneEvent),
+                                            dirty_(false),
                                             tied_(false),
                                             eventHandling_(false),
-                                            addedToLoop_(false)
+                                            addedToLoop_(false),
+                                            recvData_(nullptr),
+                                            recvResult_(0),
+                                            sendResult_(0)
 {
 }
 
@@ -68,7 +76,11 @@ void Channel::handleEventWithGurad(Timestamp receiveTime) // handleEventWithGura
         LOG_WARN << "fd = " << fd_ << "Channel::handle_event() POLLNVAL";
     }
 
-    if (revents_ & (POLLERR | POLLNVAL))
+    if ((revents_ & POLLERR) && errorQueueCallback_)
+    { // 错误队列非空也会报POLLERR 由errorQueueCallback_读空错误队列 其中没有通知时它自己回调错误处理
+        errorQueueCallback_();
+    }
+    else if (revents_ & (POLLERR | POLLNVAL))
     {
         if (errorCallback_)
             errorCallback_();
@@ -84,6 +96,16 @@ void Channel::handleEventWithGurad(Timestamp receiveTime) // handleEventWithGura
         if (writeCallback_)
             writeCallback_();
     }
+    if (revents_ & kRecvCompleteEvent) // 完成模式: 异步接收完成
+    {
+        if (recvCompleteCallback_)
+            recvCompleteCallback_(recvData_, recvResult_, receiveTime);
+    }
+    if (revents_ & kSendCompleteEvent) // 完成模式: 异步发送完成
+    {
+        if (sendCompleteCallback_)
+            sendCompleteCallback_(sendResult_);
+    }
     eventHandling_ = false;
 }
 
@@ -135,6 +157,14 @@ string Channel::eventsToString(int fd, int ev)
     {
         oss << "NAVL ";
     }
+    if (ev & kRecvCompleteEvent)
+    {
+        oss << "RECV_DONE ";
+    }
+    if (ev & kSendCompleteEvent)
+    {
+        oss << "SEND_DONE ";
+    }
     return oss.str();
 }
 
@@ -4,6 +4,8 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <sys/types.h>
+#include "base/InplaceFunction.h"
 #include "base/Noncopyable.h"
 #include "base/Timestamp.h"
 using namespace std;
@@ -17,8 +19,16 @@ class EventLoop;
 class Channel // 被EventLoop聚合
 {
 public:
-    typedef function<void()> EventCallback;
-    typedef function<void(Timestamp)> ReadEventCallback;
+    // 回调通常是bind(成员函数, this) 放在InplaceFunction内部 每个Channel不再为回调分配堆内存
+    typedef InplaceTask EventCallback;
+    typedef InplaceFunction<void(Timestamp)> ReadEventCallback;
+    // 完成模式: data是Poller持有的接收缓冲区 只在回调期间有效; n < 0 时为 -errno
+    typedef InplaceFunction<void(const char *data, ssize_t n, Timestamp)> RecvCompleteCallback;
+    typedef InplaceFunction<void(ssize_t n)> SendCompleteCallback;
+
+    // 只出现在revents中的伪事件 由支持完成模式的Poller设置
+    static const int kRecvCompleteEvent;
+    static const int kSendCompleteEvent;
 
 private:
     static string eventsToString(int fd, int e);
@@ -36,6 +46,9 @@ private:
     int revents_;     // it's the receievd event types of epoll or poll
     int index_;       // used by pollers;表示在poll的事件数组中的序号
     bool logHup_;     // for POLLHUP 对方描述符挂起事件
+    bool edgeTriggered_; // 是否以边沿触发方式关注 只有EPollPoller支持
+    int committedEvents_; // 最近一次真正提交给Poller的关注事件
+    bool dirty_;          // 关注的事件改过 还在EventLoop的待提交列表中
 
     std::weak_ptr<void> tie_;//
     bool tied_;
@@ -45,6 +58,12 @@ private:
     EventCallback writeCallback_;
     EventCallback closeCallback_;
     EventCallback errorCallback_;
+    EventCallback errorQueueCallback_; // POLLERR时先交给它读socket的错误队列(MSG_ZEROCOPY的完成通知也从这里来)
+    RecvCompleteCallback recvCompleteCallback_;
+    SendCompleteCallback sendCompleteCallback_;
+    const char *recvData_; // 完成模式下本轮的读写结果
+    ssize_t recvResult_;
+    ssize_t sendResult_;
 
 public:
     Channel(EventLoop *loop, int fd); // 一个EventLoop包含多个channel 一个channel只能所属一个EventLoop
@@ -56,6 +75,9 @@ public:
     void setWriteCallback(EventCallback cb) { writeCallback_ = move(cb); }
     void setCloseCallback(EventCallback cb) { closeCallback_ = move(cb); }
     void setErrorCallback(EventCallback cb) { errorCallback_ = move(cb); }
+    void setErrorQueueCallback(EventCallback cb) { errorQueueCallback_ = move(cb); }
+    void setRecvCompleteCallback(RecvCompleteCallback cb) { recvCompleteCallback_ = move(cb); }
+    void setSendCompleteCallback(SendCompleteCallback cb) { sendCompleteCallback_ = move(cb); }
 
     void tie(const shared_ptr<void> &);
 
@@ -72,6 +94,25 @@ public:
     { // use by pollers
         revents_ = revt;
     }
+    int revents() const
+    {
+        return revents_;
+    }
+    // use by pollers 完成模式
+    void set_recvResult(const char *data, ssize_t n)
+    {
+        recvData_ = data;
+        recvResult_ = n;
+    }
+    void set_sendResult(ssize_t n)
+    {
+        sendResult_ = n;
+    }
+    // use by EventLoop 合并同一轮中的多次修改
+    int committedEvents() const { return committedEvents_; }
+    void set_committedEvents(int events) { committedEvents_ = events; }
+    bool dirty() const { return dirty_; }
+    void set_dirty(bool on) { dirty_ = on; }
     bool isNoEvent() const
     {
         return events_ == kNoneEvent;
@@ -98,6 +139,12 @@ public:
         events_ &= ~KWriteEvent;
         update();
     }
+    // 一次注册读写两个事件 供边沿触发的连接使用 之后不再需要修改
+    void enableAll()
+    {
+        events_ |= kReadEvent | KWriteEvent;
+        update();
+    }
     void disableAll()
     {
         events_ = kNoneEvent;
@@ -109,6 +156,9 @@ public:
         return events_ & KWriteEvent;
     }
     bool isReading() const { return events_ & kReadEvent; }
+    // 必须在第一次注册事件之前设置; Poller不支持边沿触发时(EventLoop::edgeTriggerSupported())这个标志被忽略
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
 
     // for Poller
     int index()
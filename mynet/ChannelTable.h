@@ -0,0 +1,65 @@
+#pragma once
+/**
+ * 以fd为下标的Channel登记表 代替原先的std::map<int, Channel *>
+ * fd是内核分配的"最小可用"整数 天然稠密 所以直接用vector按fd寻址:
+ * 查找/插入/删除都是一次数组访问 也没有每个连接一次的红黑树节点分配
+ * 空槽位为nullptr 数组只增不减 长度不会超过进程曾经用到的最大fd
+ */
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include <stddef.h>
+
+class Channel;
+
+class ChannelTable
+{
+public:
+    ChannelTable() : size_(0) {}
+
+    // 没有登记时返回nullptr
+    Channel *find(int fd) const
+    {
+        return (fd >= 0 && static_cast<size_t>(fd) < slots_.size()) ? slots_[fd] : nullptr;
+    }
+    bool contains(int fd) const { return find(fd) != nullptr; }
+
+    void insert(int fd, Channel *channel)
+    {
+        assert(fd >= 0 && channel != nullptr);
+        if (static_cast<size_t>(fd) >= slots_.size())
+        { // 按倍数增长 避免fd逐个递增时反复搬移
+            slots_.resize(std::max(static_cast<size_t>(fd) + 1, slots_.size() * 2), nullptr);
+        }
+        assert(slots_[fd] == nullptr);
+        slots_[fd] = channel;
+        ++size_;
+    }
+
+    // 返回删除的个数(0或1) 与std::map::erase一致
+    size_t erase(int fd)
+    {
+        if (!contains(fd))
+        {
+            return 0;
+        }
+        slots_[fd] = nullptr;
+        --size_;
+        return 1;
+    }
+
+    void clear()
+    {
+        std::fill(slots_.begin(), slots_.end(), nullptr);
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // 所有登记的fd都小于capacity() 可以用来遍历
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<Channel *> slots_;
+    size_t size_; // 非空槽位的个数
+};
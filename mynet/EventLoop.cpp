@@ -9,6 +9,9 @@
 #include <algorithm> //find()
 #include <sys/eventfd.h> //linux下一切皆文件
 #include "mynet/Poller.h"
+#include "mynet/BlockPool.h"
+#include "base/ConcurrentFreeList.h"
+#include "mynet/ZeroCopyGraveyard.h"
 #include "EventLoop.h"
 
 thread_local EventLoop *t_loopInThisThread = nullptr;
@@ -37,8 +40,8 @@ char *currentThreadIdToString()
 
 EventLoop::EventLoop() : looping_(false), quit_(false),
                          eventHandling_(false), callingPendingFunctors_(false), iteration_(0),
-                         threadId_(std::this_thread::get_id()), poller_(Poller::newDefualtPoller(this)), timerqueue_(new TimerQueue(this)),
-                         wakeupFd_(createEventfd()), wakeupChannel_(new Channel(this, wakeupFd_)), currentActiveChannel_(nullptr)
+                         threadId_(std::this_thread::get_id()), poller_(Poller::newDefualtPoller(this)), timerqueue_(TimerQueue::newDefaultTimerQueue(this)), blockPool_(new BlockPool), connectionPool_(std::make_shared<ConcurrentFreeList>()),
+                         wakeupFd_(createEventfd()), wakeupChannel_(new Channel(this, wakeupFd_)), elidedChannelUpdates_(0), currentActiveChannel_(nullptr), pendingCount_(0), numConnections_(0), busyMicros_(0), busyAccounting_(false)
 {
 
     LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
@@ -75,8 +78,14 @@ void EventLoop::loop()
     while (!quit_)
     {
         activeChannels_.clear(); // Channel的vector
+        flushChannelUpdates();
         //调用具体的poll函数 Epoll就是epoll_wait() Poll就是::poll() ;得到activeChannels_集合
-        pollReturnTime_ = poller_->poll(kPollTimeMS, &activeChannels_);
+        // 上一轮doPendingFunctors期间又有任务投递进来时 投递方没有唤醒 这里不能阻塞
+        int timeoutMs = pendingCount_.load(std::memory_order_acquire) > 0 ? 0 : kPollTimeMS;
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        // 统计忙碌时间时本轮开始的时刻总要读 其他时候用到再读
+        bool busyAccounting = busyAccounting_.load(std::memory_order_relaxed);
+        monoNow_ = busyAccounting ? MonoTimestamp::now() : MonoTimestamp::invalid();
         ++iteration_; //
         if (Logger::logLevel() <= Logger::TRACE)
         {
@@ -93,7 +102,16 @@ void EventLoop::loop()
         eventHandling_ = false;
 
         doPendingFunctors(); // 让IO线程也可以执行一些计算任务 使得利用率变高 而且不会一直检测pendingFunctors_是否为空 否则可能会一直处理计算任务而IO事件得不到检测
+
+        if (busyAccounting)
+        {
+            int64_t busy = MonoTimestamp::now().microSeconds() - monoNow_.microSeconds();
+            int64_t average = busyMicros_.load(std::memory_order_relaxed); // 只有本线程写
+            busyMicros_.store(average + (busy - average) / 8, std::memory_order_relaxed);
+        }
     }
+    monoNow_ = MonoTimestamp::invalid(); // loop()之外每次用到都重新读
+    flushChannelUpdates(); // loop结束后修改又变回立即生效 先把积累的修改提交掉
     LOG_TRACE << "EventLoop " << this << " stop looping";
     looping_ = false;
 }
@@ -126,21 +144,18 @@ void EventLoop::runInLoop(Functor cb) // 在io线程中执行某个回调函数
 
 void EventLoop::queueInLoop(Functor cb)
 {
+    pendingFunctors_.push(std::move(cb)); // 先入队再计数 计数到了的任务一定已经入队
+    // 只有队列从空变为非空的投递需要唤醒IO线程 之后的投递会被同一次doPendingFunctors处理 或者由loop以0超时poll接着处理
+    // IO线程自己在事件处理中投递时不需要唤醒 本轮稍后就会执行doPendingFunctors
+    if (pendingCount_.fetch_add(1, std::memory_order_acq_rel) == 0 && !isInLoopThread())
     {
-        lock_guard<mutex> lc(mutex_);
-        pendingFunctors_.push_back(cb);
-    }
-    // 调用queueInLoop的线程不是当前IO线程 或者 当前IO线程正在调用pendingfunctor 需要唤醒IO线程 因为IO线程可能处于loop的阻塞状态
-    if (!isInLoopThread() || callingPendingFunctors_) // callingPendingFunctors_的状态是true 那么这个线程是IO线程并且正处在doPendingFunctors函数中并调用了queueInLoop
-    {
-        wakeup(); //
+        wakeup();
     }
 }
 
 size_t EventLoop::queueSize() const
 {
-    lock_guard<mutex> lc(mutex_);
-    return pendingFunctors_.size();
+    return pendingCount_.load(std::memory_order_relaxed);
 }
 EventLoop *EventLoop::getEventLoopOfCurrentThread()
 {
@@ -156,11 +171,45 @@ void EventLoop::wakeup() // 唤醒 通过fd向loop的fd中发一个信号
     }
 }
 
+// loop运行期间只记下修改 在下一次poll()之前按最终状态提交一次
+// 同一轮中EPOLLOUT开了又关这样的来回修改就不会产生epoll_ctl
 void EventLoop::updateChannel(Channel *channel)
 {
     assert(channel->ownerLoop() == this);
     assertInLoopThread();
-    poller_->updateChannel(channel);
+    if (!looping_)
+    {
+        poller_->updateChannel(channel);
+        channel->set_committedEvents(channel->events());
+        return;
+    }
+    if (channel->dirty())
+    {
+        ++elidedChannelUpdates_; // 与这一轮之前的修改合并
+        return;
+    }
+    channel->set_dirty(true);
+    dirtyChannels_.push_back(channel);
+}
+
+void EventLoop::flushChannelUpdates()
+{
+    for (Channel *channel : dirtyChannels_)
+    {
+        if (!channel)
+        {
+            continue; // 已经被removeChannel移除
+        }
+        channel->set_dirty(false);
+        if (channel->events() == channel->committedEvents())
+        { // 净效果为零 或者是一个从未提交过又被取消的channel
+            ++elidedChannelUpdates_;
+            continue;
+        }
+        poller_->updateChannel(channel);
+        channel->set_committedEvents(channel->events());
+    }
+    dirtyChannels_.clear();
 }
 
 void EventLoop::removeChannel(Channel *channel)
@@ -171,7 +220,17 @@ void EventLoop::removeChannel(Channel *channel)
     {
         assert(currentActiveChannel_ == channel || std::find(activeChannels_.begin(), activeChannels_.end(), channel) == activeChannels_.end() );
     }
-    poller_->removeChannel(channel);
+    if (channel->dirty())
+    { // 还没提交的修改作废 每个连接关闭时才走到这里 线性查找的代价可以接受
+        channel->set_dirty(false);
+        *std::find(dirtyChannels_.begin(), dirtyChannels_.end(), channel) = nullptr;
+        ++elidedChannelUpdates_;
+    }
+    if (poller_->hasChannel(channel))
+    {
+        poller_->removeChannel(channel);
+    }
+    channel->set_committedEvents(channel->events()); // 被移除的channel一定不关注任何事件
 }
 
 bool EventLoop::hasChannel(Channel *channel)
@@ -181,6 +240,40 @@ assert(channel->ownerLoop() == this);
   return poller_->hasChannel(channel);
 }
 
+bool EventLoop::edgeTriggerSupported() const
+{
+    return poller_->edgeTriggerSupported();
+}
+
+ZeroCopyGraveyard *EventLoop::zeroCopyGraveyard()
+{
+    assertInLoopThread();
+    if (!zeroCopyGraveyard_)
+    { // 没有开启零拷贝的程序用不到 不必每个loop都带一个定时器对象
+        zeroCopyGraveyard_.reset(new ZeroCopyGraveyard(this));
+    }
+    return zeroCopyGraveyard_.get();
+}
+
+bool EventLoop::completionIoSupported() const
+{
+    return poller_->completionIoSupported();
+}
+
+void EventLoop::submitRecv(Channel *channel)
+{
+    assert(channel->ownerLoop() == this);
+    assertInLoopThread();
+    poller_->submitRecv(channel);
+}
+
+size_t EventLoop::submitSend(Channel *channel, const void *data, size_t len)
+{
+    assert(channel->ownerLoop() == this);
+    assertInLoopThread();
+    return poller_->submitSend(channel, data, len);
+}
+
 void EventLoop::abortNotInLoopThread()
 {
     LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
@@ -200,16 +293,19 @@ void EventLoop::handleRead()
 
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    // 只执行进入时已经计数的任务 执行中新投递的留到下一轮 避免IO事件一直得不到处理
+    const size_t n = pendingCount_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i)
     {
-        std::lock_guard<std::mutex> lc(mutex_);
-        functors.swap(pendingFunctors_); // 交换两个容器内容
-    }
-    for (const Functor &functor : functors)
-    {              // 执行回调函数
-        functor(); // 这里的functor可能再次调用queueInLoop 需要访问pendingFunctors_ 在这里如果没有解锁的话可能会死锁
+        Functor functor;
+        while (!pendingFunctors_.pop(&functor))
+        { // 排在前面的生产者已经入队但还没链接好节点 让出CPU等它完成
+            std::this_thread::yield();
+        }
+        functor(); // 这里的functor可能再次调用queueInLoop
     }
+    pendingCount_.fetch_sub(n, std::memory_order_acq_rel);
     callingPendingFunctors_ = false;
 }
 
@@ -221,21 +317,26 @@ void EventLoop::printActiveChannels() const
     }
 }
 
-TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+TimerId EventLoop::runAt(MonoTimestamp time, TimerCallback cb, double slack)
 {
-    return timerqueue_->addTimer(cb, time, 0.0);
+    return timerqueue_->addTimer(std::move(cb), time, 0.0, slack);
 }
 
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb, double slack)
 {
-    Timestamp time(addTime(Timestamp::now(), delay));
-    return runAt(time, cb);
+    return runAt(MonoTimestamp::fromWallTime(time), std::move(cb), slack);
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, double slack)
 {
-    Timestamp time(addTime(Timestamp::now(), interval));
-    return timerqueue_->addTimer(std::move(cb), time, interval);
+    MonoTimestamp time(addTime(MonoTimestamp::now(), delay)); // 可能跨线程调用 不能用monoNow()
+    return runAt(time, std::move(cb), slack);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, double slack)
+{
+    MonoTimestamp time(addTime(MonoTimestamp::now(), interval));
+    return timerqueue_->addTimer(std::move(cb), time, interval, slack);
 }
 
 void EventLoop::cancel(TimerId tiemrId)
@@ -243,6 +344,11 @@ void EventLoop::cancel(TimerId tiemrId)
     return timerqueue_->cancel(tiemrId);
 }
 
+void EventLoop::extendTimer(TimerId timerId, MonoTimestamp when)
+{
+    timerqueue_->extend(timerId, when);
+}
+
 void EventLoop::assertInLoopThread()
 {
     if (!isInLoopThread())
@@ -10,7 +10,10 @@
 #include<string>
 #include <any>
 #include "base/Timestamp.h"
+#include "base/MonoTimestamp.h"
 #include "base/Noncopyable.h"
+#include "base/MpscQueue.h"
+#include "base/InplaceFunction.h"
 #include "mynet/Callbacks.h"
 #include "mynet/TimerId.h"
 
@@ -23,36 +26,68 @@
 class Channel;
 class Poller;
 class TimerQueue;
+class BlockPool;
+class ConcurrentFreeList;
+class ZeroCopyGraveyard;
 
 class EventLoop : noncopyable
 {
 public:
-    typedef std::function<void()> Functor;
+    typedef InplaceTask Functor; // 只能移动 常见任务直接放在对象内部 投递任务时不分配内存
    
     void loop(); // 必须在产生调用这个loop()的EventLoop对象的线程里执行
 
     void quit(); // 可以跨线程调用quit
 
     Timestamp pollReturnTime() const { return pollReturnTime_; } //poll()的返回时间
+    // 单调时钟的"现在" 本轮第一次用到时读一次CLOCK_MONOTONIC 本轮之后的调用都返回同一个值
+    // 给定时器和空闲超时这类只需要本轮精度的场合用 省掉逐个读时钟; 只能在loop线程中调用
+    MonoTimestamp monoNow()
+    {
+        if (!monoNow_.valid())
+        {
+            if (!looping_)
+            { // loop()之外没有"本轮" 缓存下来就再也不会更新
+                return MonoTimestamp::now();
+            }
+            monoNow_ = MonoTimestamp::now();
+        }
+        return monoNow_;
+    }
 
     int64_t iteration() const;
+    // 因为同一轮中的多次修改被合并 或者修改后与已提交的状态相同而省掉的Poller::updateChannel(即epoll_ctl)次数
+    int64_t elidedChannelUpdates() const { return elidedChannelUpdates_; }
 
     void runInLoop(Functor cb); //让IO线程也能完成一定的计算任务 通过调用queueInLoop 用队列存储实现线程安全的异步调用
     void queueInLoop(Functor cb); //cb加入IO线程的任务队列 
 
     size_t queueSize() const;
 
+    // 负载统计 给EventLoopThreadPool选择新连接的loop用 都可以跨线程读
+    // 本loop上的TcpConnection数: 构造时(通常在main loop中)加一 connectDestroyed时减一 刚分配还没建立的连接也算在内
+    int connectionCount() const { return numConnections_.load(std::memory_order_relaxed); }
+    // 最近每轮处理事件和任务所花的时间(微秒 指数移动平均 新样本占1/8) 不包括阻塞在poll中的时间
+    // 要先setBusyAccounting(true)才统计: 每轮多读两次时钟 只有kLeastBusy策略用到
+    int64_t recentBusyMicros() const { return busyMicros_.load(std::memory_order_relaxed); }
+    void setBusyAccounting(bool on) { busyAccounting_.store(on, std::memory_order_relaxed); } // 可以跨线程调用 下一轮生效
+
 
     //**timers
 
     //run cb at time ,safe to call from other threads
-    TimerId runAt(Timestamp time,TimerCallback cb); //在某个时刻运行定时器
+    //@c slack: the timer may fire up to @c slack seconds late, so that nearby timers share one wakeup
+    TimerId runAt(MonoTimestamp time,TimerCallback cb, double slack = 0.0); //在单调时钟的某个时刻运行定时器
+    //wall clock version: converted to the monotonic clock once, later clock adjustments don't move it
+    TimerId runAt(Timestamp time,TimerCallback cb, double slack = 0.0); //在某个时刻运行定时器
     //run cb after @c delay seconds ,safe to call from other threads
-    TimerId runAfter(double delay,TimerCallback cb);//过一段时间运行定时器
+    TimerId runAfter(double delay,TimerCallback cb, double slack = 0.0);//过一段时间运行定时器
     //run cb after every @c interval seconds ,safe to call from other threads
-    TimerId runEvery(double interval, TimerCallback cb);//每隔一段时间运行定时器
+    TimerId runEvery(double interval, TimerCallback cb, double slack = 0.0);//每隔一段时间运行定时器
 
     void cancel(TimerId tiemrId); //取消定时器
+    //move the timer's deadline to @c when ,cheap in the loop thread (no allocation, no queued task)
+    void extendTimer(TimerId timerId, MonoTimestamp when); //修改还没到期的定时器的超时时刻 已经到期/取消的忽略
 
 
     void assertInLoopThread();
@@ -77,16 +112,30 @@ public:
     static EventLoop *getEventLoopOfCurrentThread();
 
     // internal usage
+    void connectionCreated() { numConnections_.fetch_add(1, std::memory_order_relaxed); }
+    void connectionDestroyed() { numConnections_.fetch_sub(1, std::memory_order_relaxed); }
     void wakeup();
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
+    bool edgeTriggerSupported() const;
+    // 完成模式的异步读写 转发给Poller 只能在loop线程调用
+    bool completionIoSupported() const;
+    void submitRecv(Channel *channel);
+    size_t submitSend(Channel *channel, const void *data, size_t len);
+    // 本loop上各连接共用的16KB内存块池(OutputQueue ChainBuffer使用) 只能在loop线程使用
+    BlockPool *blockPool() { return blockPool_.get(); }
+    // 在本loop线程中创建的TcpConnection(连同shared_ptr控制块)从这里分配 只能在loop线程分配 任何线程都可以释放
+    const std::shared_ptr<ConcurrentFreeList> &connectionPool() const { return connectionPool_; }
+    // 已经销毁的连接上还在等完成通知的零拷贝内存 第一次用到时创建 只能在loop线程使用
+    ZeroCopyGraveyard *zeroCopyGraveyard();
 
 
 private:
     void abortNotInLoopThread();
     void handleRead(); //wakeup
     void doPendingFunctors(); //执行 其他线程或者本线程添加的一些IO任务
+    void flushChannelUpdates(); //把本轮积累的关注事件修改一次性提交给Poller
 
     void printActiveChannels() const; // for debug
 
@@ -100,17 +149,26 @@ private:
     // const std::string threadId_; //c++标准库的thread id过长 直接按字符处理；注意在多进程中可能会有两个相同的线程id
     const std::thread::id threadId_;
     Timestamp pollReturnTime_;
+    MonoTimestamp monoNow_; // 本轮第一次用到时读的时刻 每轮poll返回时置为无效(统计忙碌时间时立即读) loop()之外始终无效
     std::unique_ptr<Poller> poller_;
     std::unique_ptr<TimerQueue> timerqueue_;
+    std::unique_ptr<BlockPool> blockPool_;
+    std::shared_ptr<ConcurrentFreeList> connectionPool_; // 连接可能比loop活得久 由分配器共同持有
+    std::unique_ptr<ZeroCopyGraveyard> zeroCopyGraveyard_; // 持有定时器 要在timerqueue_之前析构
     int wakeupFd_;  //由于eventfd
     std::unique_ptr<Channel> wakeupChannel_;
     std::any context_; //c++17
 
     ChannelList activeChannels_;
+    ChannelList dirtyChannels_; //loop运行期间修改过关注事件的channel 在下一次poll()之前提交; 中途被移除的置为nullptr
+    int64_t elidedChannelUpdates_;
     Channel *currentActiveChannel_; //当前正在处理的channel
 
-    mutable std::mutex mutex_;
-    std::vector<Functor> pendingFunctors_; //IO线程的计算任务队列 大部分都是其他线程添加进来的任务
+    MpscQueue<Functor> pendingFunctors_; //IO线程的计算任务队列 大部分都是其他线程添加进来的任务 无锁
+    std::atomic<size_t> pendingCount_;   //已投递但还没执行的任务数 只有从0变为1的投递才需要唤醒IO线程
+    std::atomic<int> numConnections_;
+    std::atomic<int64_t> busyMicros_;
+    std::atomic<bool> busyAccounting_;
 
 public:
     EventLoop(/* args */);
@@ -35,6 +35,10 @@ EventLoop *EventLoopThread::startLoop() //将这个线程中的EventlLoop对象
 
 void EventLoopThread::threadFunc() //创造EventLoopThread对象，新线程默认执行的函数
 {
+    if (!placement_.empty())
+    { // 先绑核再创建loop: loop的内存由本线程首次写入 分配在本地NUMA节点上
+        affinity::apply(placement_);
+    }
     EventLoop loop; //在这个线程中创造一个EventLoop对象
     if(callback_){
         callback_(&loop);
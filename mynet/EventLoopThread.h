@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base/Noncopyable.h"
+#include "base/CpuAffinity.h"
 #include <functional>
 #include <thread>
 #include <string>
@@ -14,6 +15,8 @@ public:
     EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),const std::string& name = std::string());
     ~EventLoopThread();
 
+    // 线程在构造EventLoop之前绑到placement 必须在startLoop()之前调用
+    void setPlacement(const CpuPlacement &placement){ placement_ = placement; }
     EventLoop* startLoop();
 private :
     void threadFunc();
@@ -25,4 +28,5 @@ private :
     
     ThreadInitCallback callback_;
     std::string name_;        
+    CpuPlacement placement_;
 };
\ No newline at end of file
@@ -1,23 +1,46 @@
 #include "EventLoopThreadPool.h"
 #include "mynet/EventLoop.h"
 #include "mynet/EventLoopThread.h"
+#include <algorithm>
 #include <assert.h>
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseloop, const std::string &nameArg)
-    : baseLoop_(baseloop), name_(nameArg), started_(false), numThread_(0), next_(0)
+    : baseLoop_(baseloop), name_(nameArg), started_(false), numThread_(0), next_(0), policy_(kRoundRobin)
 {
 }
 
+namespace
+{
+// splitmix64的混合函数 把相邻的整数打散到整个64位空间
+uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+}
+
 EventLoopThreadPool::~EventLoopThreadPool()
 { // 不用delete loop 因为都是栈上对象
 }
 
+void EventLoopThreadPool::setDispatchPolicy(DispatchPolicy policy)
+{
+    assert(!started_); // start()之后再换成kConsistentHash 环是空的
+    policy_ = policy;
+}
+
 void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     assert(!started_);
     baseLoop_->assertInLoopThread();
 
     started_ = true;
+    if (!basePlacement_.empty())
+    {
+        affinity::apply(basePlacement_);
+    }
     for (int i = 0; i < numThread_; ++i)
     {
         char buf[name_.size() + 32];
@@ -25,8 +48,30 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 
         EventLoopThread *t = new EventLoopThread(cb, buf); // new出来的EventLoopThread类对象 由智能指针负责销毁  
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));//因为是unique指针 所以可以这样初始化 但也不推荐野指针和指针指针混用 不然推荐用make_share
+        if (static_cast<size_t>(i) < placements_.size())
+        {
+            t->setPlacement(placements_[i]);
+        }
         loops_.push_back(t->startLoop());
     }
+    if (policy_ == kLeastBusy)
+    { // 其他策略用不到忙碌时间 loop不必每轮多读两次时钟
+        for (EventLoop *loop : loops_)
+        {
+            loop->setBusyAccounting(true);
+        }
+    }
+    if (policy_ == kConsistentHash)
+    { // 节点位置只取决于loop的序号和副本号 同样的线程数总是建出同样的环
+        for (size_t i = 0; i < loops_.size(); ++i)
+        {
+            for (int replica = 0; replica < kVirtualNodes; ++replica)
+            {
+                ring_.emplace_back(mix64(i * kVirtualNodes + replica), loops_[i]);
+            }
+        }
+        std::sort(ring_.begin(), ring_.end());
+    }
     if (numThread_ == 0 && cb)
     {
         cb(baseLoop_);//只有一个EventLoop的话 在进入loop循环之前会调用cb_
@@ -63,11 +108,70 @@ EventLoop *EventLoopThreadPool::getLoopForHash(size_t hashcode)
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForConnection(size_t peerHash)
+{
+    baseLoop_->assertInLoopThread();
+    assert(started_);
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+    switch (policy_)
+    {
+    case kLeastConnections:
+        return getLeastLoaded([](EventLoop *loop)
+                              { return static_cast<int64_t>(loop->connectionCount()); });
+    case kLeastQueue:
+        return getLeastLoaded([](EventLoop *loop)
+                              { return static_cast<int64_t>(loop->queueSize()); });
+    case kLeastBusy:
+        return getLeastLoaded([](EventLoop *loop)
+                              { return loop->recentBusyMicros(); });
+    case kConsistentHash:
+        return getLoopOnRing(peerHash);
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
+template <typename Load>
+EventLoop *EventLoopThreadPool::getLeastLoaded(Load load)
+{ // 从next_开始找 负载相同时取先找到的 next_再后移一位 所以负载都一样时退化为轮询
+    size_t n = loops_.size();
+    size_t best = next_;
+    int64_t bestLoad = load(loops_[best]);
+    for (size_t k = 1; k < n && bestLoad > 0; ++k)
+    {
+        size_t i = (next_ + k) % n;
+        int64_t l = load(loops_[i]);
+        if (l < bestLoad)
+        {
+            best = i;
+            bestLoad = l;
+        }
+    }
+    next_ = static_cast<int>((next_ + 1) % n);
+    return loops_[best];
+}
+
+EventLoop *EventLoopThreadPool::getLoopOnRing(size_t hashcode) const
+{ // 顺时针找第一个不小于哈希值的节点 越过末尾回到开头
+    assert(!ring_.empty());
+    uint64_t h = mix64(hashcode);
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(h, static_cast<EventLoop *>(nullptr)));
+    if (it == ring_.end())
+    {
+        it = ring_.begin();
+    }
+    return it->second;
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
 {
     baseLoop_->assertInLoopThread();
     assert(started_);
-    if(!loops_.empty()){
+    if(loops_.empty()){ // 没有IO线程时所有连接都在baseLoop_上
         return std::vector<EventLoop*>(1,baseLoop_);
     }else{
         return loops_;
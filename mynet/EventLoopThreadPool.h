@@ -1,10 +1,12 @@
 #pragma once
 
 #include "base/Noncopyable.h"
+#include "base/CpuAffinity.h"
 #include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 
 class EventLoop;
 class EventLoopThread;
@@ -13,13 +15,31 @@ class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
+    // 新连接分给哪个IO loop 负载类的策略取值相同时按轮询的顺序选 负载都是选择时刻的快照
+    enum DispatchPolicy
+    {
+        kRoundRobin,      // 轮询(默认)
+        kLeastConnections,// EventLoop::connectionCount()最小
+        kLeastQueue,      // EventLoop::queueSize() 还没执行的任务最少
+        kLeastBusy,       // EventLoop::recentBusyMicros() 最近每轮的处理时间最短 只有这个策略让loop统计忙碌时间
+        kConsistentHash   // 按对端地址的一致性哈希 同一个客户端总是落在同一个loop上
+    };
     EventLoopThreadPool(EventLoop *baseloop,const std::string & nameArg);
     ~EventLoopThreadPool();
     void setThreadNum(int numThread){numThread_ = numThread;}
+    //第i个IO线程绑到placements[i] 不足的线程不绑 例如setThreadPlacements(affinity::spreadLoops(n)) 必须在start()之前调用
+    void setThreadPlacements(const std::vector<CpuPlacement> &placements){ placements_ = placements; }
+    //baseLoop所在的线程(accept)在start()中绑到placement 可以与IO线程分开 必须在start()之前调用
+    void setBaseLoopPlacement(const CpuPlacement &placement){ basePlacement_ = placement; }
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     EventLoop* getNextLoop();
     EventLoop* getLoopForHash(size_t hashcode);
+    // 按dispatch策略给新连接选一个loop peerHash只有kConsistentHash用到
+    EventLoop* getLoopForConnection(size_t peerHash);
+
+    void setDispatchPolicy(DispatchPolicy policy); // 必须在start()之前调用 一致性哈希的环在start()中建好
+    DispatchPolicy dispatchPolicy() const{return policy_;}
 
     std::vector<EventLoop*> getAllLoops();
 
@@ -31,6 +51,12 @@ public:
         return name_;
     }
 private:
+    static const int kVirtualNodes = 64; // 一致性哈希中每个loop在环上的节点数 越多分布越均匀
+
+    template <typename Load>
+    EventLoop *getLeastLoaded(Load load);
+    EventLoop *getLoopOnRing(size_t hashcode) const;
+
     EventLoop *baseLoop_;
     std::string name_;
     bool started_;
@@ -38,6 +64,10 @@ private:
     int next_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
+    DispatchPolicy policy_;
+    std::vector<CpuPlacement> placements_;
+    CpuPlacement basePlacement_;
+    std::vector<std::pair<uint64_t, EventLoop *>> ring_; // 一致性哈希环 按哈希值排序 start()时建好
 };
 
 
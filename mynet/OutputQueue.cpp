@@ -0,0 +1,295 @@
+#include "mynet/OutputQueue.h"
+#include "base/Logger.h"
+#include "mynet/SocketsOps.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <sys/socket.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+FileRange &FileRange::operator=(FileRange &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+        fd_ = other.fd_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+FileRange::~FileRange()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+OutputSlice::OutputSlice(std::string &&str)
+    : owner_(std::move(str)), block_(nullptr), begin_(0), end_(0)
+{
+    end_ = std::get<std::string>(owner_).size();
+}
+
+OutputSlice::OutputSlice(Buffer &&buf)
+    : owner_(Buffer(0)), block_(nullptr), begin_(0), end_(0)
+{
+    Buffer &own = std::get<Buffer>(owner_);
+    own.swap(buf); // 调用方的buf留下一个空的Buffer 仍然可以继续使用
+    end_ = own.readableBytes();
+}
+
+OutputSlice::OutputSlice(std::unique_ptr<char[]> data, size_t len)
+    : owner_(std::move(data)), block_(nullptr), begin_(0), end_(len)
+{
+}
+
+OutputSlice::OutputSlice(std::shared_ptr<const void> owner, const char *data, size_t len)
+    : owner_(std::move(owner)), block_(data), begin_(0), end_(len)
+{
+}
+
+OutputSlice::OutputSlice(FileRange file, off_t offset, size_t len)
+    : owner_(std::move(file)), block_(nullptr), begin_(static_cast<size_t>(offset)), end_(static_cast<size_t>(offset) + len)
+{
+}
+
+OutputSlice::OutputSlice(PooledBlock block)
+    : owner_(std::move(block)), block_(nullptr), begin_(0), end_(0)
+{
+}
+
+size_t OutputSlice::appendToBlock(const char *data, size_t len)
+{
+    PooledBlock *block = std::get_if<PooledBlock>(&owner_);
+    if (!block)
+    {
+        return 0;
+    }
+    size_t n = std::min(len, BlockPool::kBlockSize - end_);
+    memcpy(block->data() + end_, data, n);
+    end_ += n;
+    return n;
+}
+
+const char *OutputSlice::baseOf(const Owner &owner, const char *block)
+{
+    switch (owner.index())
+    {
+    case 0:
+        return std::get<0>(owner).data();
+    case 1:
+        return std::get<1>(owner).peek();
+    case 2:
+        return std::get<2>(owner).get();
+    case 3:
+        return block;
+    case 4:
+        return std::get<4>(owner).data();
+    default:
+        return nullptr; // 文件区间
+    }
+}
+
+std::shared_ptr<const void> OutputSlice::share()
+{
+    if (auto *shared = std::get_if<std::shared_ptr<const void>>(&owner_))
+    {
+        return *shared;
+    }
+    assert(!isFile());
+    // 原来的所有者整体搬进一个引用计数的holder 除了短字符串(远小于零拷贝阈值) 数据本身不移动
+    auto holder = std::make_shared<Owner>(std::move(owner_));
+    const char *data = baseOf(*holder, block_);
+    owner_ = std::shared_ptr<const void>(holder, data);
+    block_ = data;
+    return std::get<std::shared_ptr<const void>>(owner_);
+}
+
+void OutputQueue::append(const void *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    const char *d = static_cast<const char *>(data);
+    bytes_ += len;
+    if (!slices_.empty())
+    {
+        size_t n = slices_.back().appendToBlock(d, len);
+        d += n;
+        len -= n;
+    }
+    while (len > 0)
+    { // 大块数据拆到多个块中
+        slices_.push_back(OutputSlice(PooledBlock(pool_)));
+        size_t n = slices_.back().appendToBlock(d, len);
+        d += n;
+        len -= n;
+    }
+}
+
+void OutputQueue::append(OutputSlice &&slice)
+{
+    if (slice.empty())
+    {
+        return;
+    }
+    bytes_ += slice.size();
+    if (slice.isFile())
+    {
+        fileBytes_ += slice.size();
+    }
+    slices_.push_back(std::move(slice));
+}
+
+void OutputQueue::retrieve(size_t n)
+{
+    assert(n <= bytes_);
+    bytes_ -= n;
+    while (n > 0)
+    {
+        OutputSlice &front = slices_.front();
+        size_t consumed = std::min(n, front.size());
+        if (front.isFile())
+        {
+            fileBytes_ -= consumed;
+        }
+        n -= consumed;
+        if (consumed < front.size())
+        {
+            front.retrieve(consumed);
+            break;
+        }
+        slices_.pop_front(); // 整段发送完 释放其持有的内存(关闭文件)
+    }
+}
+
+void OutputQueue::retrieveAll()
+{
+    // pinned_不动: 内核虽然持有页面的引用 不会访问非法内存 但是close()之后没有确认的数据还在发送队列里
+    // 内存提前释放被别处复用 重传出去的就是别人的数据 只能等完成通知(连接销毁后见ZeroCopyGraveyard)
+    slices_.clear();
+    bytes_ = 0;
+    fileBytes_ = 0;
+}
+
+void ZeroCopyPins::complete(uint32_t lo, uint32_t hi)
+{
+    // 通知按发送顺序到来 内核可能把相邻的多次合并成一个区间; 序号回绕时按差值比较
+    while (!pinned_.empty() && static_cast<int32_t>(pinned_.front().seq - hi) <= 0)
+    {
+        assert(static_cast<int32_t>(pinned_.front().seq - lo) >= 0);
+        pinned_.pop_front();
+    }
+}
+
+void OutputQueue::completeZeroCopy(uint32_t lo, uint32_t hi)
+{
+    if (pinned_)
+    {
+        pinned_->complete(lo, hi);
+    }
+}
+
+std::unique_ptr<ZeroCopyPins> OutputQueue::releasePinned()
+{
+    if (pinned_ && pinned_->empty())
+    {
+        pinned_.reset();
+    }
+    return std::move(pinned_);
+}
+
+ssize_t OutputQueue::sendZeroCopy(int fd, int *savedErrno)
+{
+    OutputSlice &front = slices_.front();
+    ssize_t n = ::send(fd, front.data(), front.size(), MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+        if (errno == ENOBUFS)
+        { // 超出了locked memory限制(optmem/RLIMIT_MEMLOCK) 这一次退回普通的拷贝发送
+            n = sockets::write(fd, front.data(), front.size());
+            if (n < 0)
+            {
+                *savedErrno = errno;
+                return n;
+            }
+            retrieve(n);
+        }
+        return n;
+    }
+    // 每次成功的MSG_ZEROCOPY调用占一个序号 发出去的部分即使从队列中移除 内存也要留到完成通知
+    if (!pinned_)
+    {
+        pinned_.reset(new ZeroCopyPins);
+    }
+    pinned_->pin(zeroCopySeq_++, front.share());
+    retrieve(n);
+    return n;
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *savedErrno)
+{
+    if (!slices_.empty() && zeroCopyEligible(slices_.front()))
+    {
+        return sendZeroCopy(fd, savedErrno);
+    }
+
+    if (!slices_.empty() && slices_.front().isFile())
+    {
+        const OutputSlice &file = slices_.front();
+        off_t offset = file.fileOffset();
+        ssize_t n = ::sendfile(fd, file.fileFd(), &offset, file.size()); // 内核一次最多发送0x7ffff000字节
+        if (n < 0)
+        {
+            *savedErrno = errno;
+        }
+        else if (n == 0)
+        { // 文件比排队时短(被截断了) 剩下的区间永远发不出去 丢弃 当作有进展返回0 调用方接着发送后面的数据
+            LOG_WARN << "OutputQueue::writeFd file fd " << file.fileFd() << " truncated, dropping " << file.size() << " bytes";
+            retrieve(file.size());
+        }
+        else
+        {
+            retrieve(n);
+        }
+        return n;
+    }
+
+    iovec vec[IOV_MAX];
+    int iovcnt = 0;
+    for (auto it = slices_.begin(); it != slices_.end() && !it->isFile() && iovcnt < IOV_MAX; ++it)
+    {
+        if (iovcnt > 0 && zeroCopyEligible(*it))
+        {
+            break; // 大切片等它到了队首再单独零拷贝发送
+        }
+        vec[iovcnt].iov_base = const_cast<char *>(it->data());
+        vec[iovcnt].iov_len = it->size();
+        ++iovcnt;
+    }
+    ssize_t n = iovcnt == 1 ? sockets::write(fd, vec[0].iov_base, vec[0].iov_len) : sockets::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+    else
+    {
+        retrieve(n);
+    }
+    return n;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "mynet/BlockPool.h"
+#include "mynet/Buffer.h"
+#include "mynet/SharedSlice.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <variant>
+#include <sys/types.h>
+
+// 持有一个文件描述符 析构时关闭 只能移动; sendFile排队的文件区间用它保证发送期间文件一直打开
+class FileRange
+{
+public:
+    explicit FileRange(int fd) : fd_(fd) {}
+    FileRange(FileRange &&other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+    FileRange &operator=(FileRange &&other) noexcept;
+    FileRange(const FileRange &) = delete;
+    FileRange &operator=(const FileRange &) = delete;
+    ~FileRange();
+
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+/**
+ * 输出队列中的一段待发送数据 同时持有这段数据的所有权
+ * 数据来源可以是移交进来的std::string/Buffer/unique_ptr<char[]> 或者引用计数的内存块(shared_ptr持有)
+ * 不保存裸指针 只保存相对于所有者起始位置的偏移 所以OutputSlice本身可以随意移动(std::string的短字符串也没有问题)
+ * 也可以是文件的一个区间 这时没有data() 由OutputQueue用sendfile(2)发送
+ */
+class OutputSlice
+{
+public:
+    explicit OutputSlice(std::string &&str);
+    explicit OutputSlice(Buffer &&buf); // 只发送buf的可读区域
+    OutputSlice(std::unique_ptr<char[]> data, size_t len);
+    // 引用计数的内存块: owner保证[data, data + len)在切片存在期间有效
+    OutputSlice(std::shared_ptr<const void> owner, const char *data, size_t len);
+    explicit OutputSlice(const SharedSlice &shared) : OutputSlice(shared.owner(), shared.data(), shared.size()) {}
+    // 文件区间[offset, offset + len)
+    OutputSlice(FileRange file, off_t offset, size_t len);
+
+    bool isFile() const { return std::holds_alternative<FileRange>(owner_); }
+    bool isPooledBlock() const { return std::holds_alternative<PooledBlock>(owner_); } // OutputQueue拷贝数据用的块
+    int fileFd() const { return std::get<FileRange>(owner_).fd(); }
+    off_t fileOffset() const { return static_cast<off_t>(begin_); } // 文件区间的begin_就是文件偏移
+
+    const char *data() const { assert(!isFile()); return base() + begin_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    // 丢弃头部n个已经发送的字节
+    void retrieve(size_t n)
+    {
+        assert(n <= size());
+        begin_ += n;
+    }
+
+private:
+    friend class OutputQueue;
+
+    // 输出队列存放拷贝数据的块 来自loop的BlockPool 有剩余空间时可以继续在尾部追加
+    explicit OutputSlice(PooledBlock block);
+    size_t appendToBlock(const char *data, size_t len); // 返回追加进去的字节数
+
+    const char *base() const { return baseOf(owner_, block_); }
+    // 把所有权换成引用计数 返回一份引用; 零拷贝发送后内核完成通知之前 内存由OutputQueue另外保留这一份
+    std::shared_ptr<const void> share();
+
+    typedef std::variant<std::string, Buffer, std::unique_ptr<char[]>, std::shared_ptr<const void>, PooledBlock, FileRange> Owner;
+
+    static const char *baseOf(const Owner &owner, const char *block);
+
+    Owner owner_;
+    const char *block_; // 只对引用计数的内存块有意义: 数据的起始位置
+    size_t begin_;      // 待发送区域[begin_, end_) 相对于base()的偏移
+    size_t end_;
+};
+
+/**
+ * 零拷贝发送出去、还在等内核完成通知的内存 按序号递增
+ * 通知到来之前内核的发送队列还引用着这些页面(重传也从这里读) 内存不能释放或者复用
+ * 连接销毁时还没有完成的 连同socket一起交给loop的ZeroCopyGraveyard
+ */
+class ZeroCopyPins : noncopyable
+{
+public:
+    void pin(uint32_t seq, std::shared_ptr<const void> owner) { pinned_.push_back(Pinned{seq, std::move(owner)}); }
+    // 内核通知序号[lo, hi]的零拷贝发送已经完成 释放对应的内存 序号是32位的 会回绕
+    void complete(uint32_t lo, uint32_t hi);
+    size_t size() const { return pinned_.size(); }
+    bool empty() const { return pinned_.empty(); }
+
+private:
+    struct Pinned
+    {
+        uint32_t seq;
+        std::shared_ptr<const void> owner;
+    };
+    std::deque<Pinned> pinned_;
+};
+
+/**
+ * TcpConnection的输出队列 代替原先连续的outputBuffer_
+ * 由若干OutputSlice组成的链表 移交所有权的数据整块挂到队尾 不拷贝
+ * 只有调用方保留所有权的数据(const void *)才需要拷贝 拷贝进BlockPool的16KB块 零散的小块合并进队尾的块
+ * 不会出现连续缓冲区扩容时的vector增长和makeSpace搬移 块在同一loop的连接之间复用
+ * 发送时用writev一次最多提交IOV_MAX段 遇到文件区间就停下 文件区间在队首时用sendfile(2)发送 内容不经过用户态
+ * 开启零拷贝后 不小于阈值、移交了所有权的切片在队首时单独用send(MSG_ZEROCOPY)发送 内核直接引用这段内存
+ * 发出去的部分从队列中移除 但内存要保留到socket错误队列上的完成通知到来(completeZeroCopy)
+ */
+class OutputQueue : noncopyable
+{
+public:
+    // pool为拷贝数据提供内存块 一般是连接所属loop的EventLoop::blockPool()
+    explicit OutputQueue(BlockPool *pool)
+        : pool_(pool), bytes_(0), fileBytes_(0), zeroCopyThreshold_(0), zeroCopySeq_(0) {}
+
+    size_t readableBytes() const { return bytes_; } // 包括文件区间
+    size_t memoryBytes() const { return bytes_ - fileBytes_; } // 占用内存的部分 高水位只看这部分
+    bool empty() const { return bytes_ == 0; }
+    size_t sliceCount() const { return slices_.size(); }
+
+    void append(const void *data, size_t len); // 拷贝
+    void append(OutputSlice &&slice);          // 移交所有权
+
+    // 队首一段连续的数据(或者文件区间) 完成模式下交给Poller发送
+    const OutputSlice &front() const { return slices_.front(); }
+
+    // 丢弃头部n个已经发送的字节
+    void retrieve(size_t n);
+    void retrieveAll(); // 丢弃还没发送的数据 零拷贝发出去的内存仍然保留到完成通知
+
+    // writev把尽可能多的数据写入fd(队首是文件区间时用sendfile) 成功写入的部分从队列中移除 出错时返回-1并设置savedErrno
+    // 队首的文件被截断(sendfile返回0)时丢弃这个区间并返回0 队列可能因此变空 调用方每次都要检查empty()
+    ssize_t writeFd(int fd, int *savedErrno);
+
+    // 不小于threshold的内存切片用MSG_ZEROCOPY发送 0表示关闭; fd必须已经设置了SO_ZEROCOPY
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // 只有移交了所有权的内存切片: 拷贝进BlockPool块的数据已经付出了一次拷贝 再零拷贝发送只会把块钉住等完成通知
+    // 块要尽快还给loop的BlockPool给别的连接用
+    bool zeroCopyEligible(const OutputSlice &slice) const
+    {
+        return zeroCopyThreshold_ > 0 && !slice.isFile() && !slice.isPooledBlock() && slice.size() >= zeroCopyThreshold_;
+    }
+    // 内核通知序号[lo, hi]的零拷贝发送已经完成 释放对应的内存 序号是32位的 会回绕
+    void completeZeroCopy(uint32_t lo, uint32_t hi);
+    size_t pinnedSlices() const { return pinned_ ? pinned_->size() : 0; } // 等待完成通知的发送次数
+    // 交出还在等完成通知的内存 没有时返回空 连接销毁时由ZeroCopyGraveyard接着等
+    std::unique_ptr<ZeroCopyPins> releasePinned();
+
+private:
+    ssize_t sendZeroCopy(int fd, int *savedErrno);
+
+    BlockPool *pool_;
+    std::deque<OutputSlice> slices_;
+    size_t bytes_; // 所有切片的待发送字节数之和
+    size_t fileBytes_; // 其中文件区间的字节数
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopySeq_;       // 下一次成功的MSG_ZEROCOPY调用的序号 与内核为这个socket维护的计数一致
+    std::unique_ptr<ZeroCopyPins> pinned_; // 已经发出 还在等完成通知的内存; 第一次零拷贝发送时才创建 std::deque构造时就要分配内存
+};
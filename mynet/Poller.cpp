@@ -1,6 +1,7 @@
 #include "Poller.h"
 #include "mynet/EventLoop.h"
 #include "mynet/Channel.h"
+#include "base/Logger.h"
 Poller::Poller(EventLoop *loop):ownerLoop_(loop)
 {
 }
@@ -11,8 +12,18 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
     assertInLoopThread();
-    ChannelMap::const_iterator it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return channels_.find(channel->fd()) == channel;
+}
+
+void Poller::submitRecv(Channel *channel)
+{
+    LOG_FATAL << "Poller::submitRecv fd = " << channel->fd() << " - completion I/O is not supported";
+}
+
+size_t Poller::submitSend(Channel *channel, const void *, size_t)
+{
+    LOG_FATAL << "Poller::submitSend fd = " << channel->fd() << " - completion I/O is not supported";
+    return 0;
 }
 
 // Poller *Poller::newDefualtPoller(EventLoop *loop)
@@ -6,10 +6,10 @@
  * 将发生了的事件通过调用 Channel::set_revents 记录在该 Channel 中，并返回这些 Channel
 */
 #include <vector>
-#include <map>
 #include <chrono>
 #include "base/Noncopyable.h"
 #include "base/Timestamp.h"
+#include "mynet/ChannelTable.h"
 
 class Channel;
 class EventLoop;
@@ -26,14 +26,22 @@ public:
     virtual void updateChannel(Channel *Channel) = 0;
     virtual void removeChannel(Channel *Channel) = 0;
     virtual bool hasChannel(Channel *Channel) const;
+    // 是否支持Channel::setEdgeTriggered 默认只有电平触发
+    virtual bool edgeTriggerSupported() const { return false; }
+
+    // 完成模式(proactor)的异步读写 由内核直接把数据读入/写出Poller管理的缓冲区
+    // 结果通过Channel的RecvComplete/SendComplete回调返回 默认不支持 只有IoUringPoller实现
+    virtual bool completionIoSupported() const { return false; }
+    virtual void submitRecv(Channel *channel);
+    //返回被接收(拷贝进发送缓冲块)的字节数 剩余部分需要在发送完成后再次提交
+    virtual size_t submitSend(Channel *channel, const void *data, size_t len);
 
     
     void assertInLoopThread() const;
 
     static Poller* newDefualtPoller(EventLoop* loop);
 protected:
-    typedef std::map<int, Channel *> ChannelMap;
-    ChannelMap channels_; //每一个Poller对象 可以有多个channel对象，通过每个channel对象拥有的fd来标识不同的channel
+    ChannelTable channels_; //每一个Poller对象 可以有多个channel对象，通过每个channel对象拥有的fd来标识不同的channel 以fd为下标
 
 private:
     EventLoop* ownerLoop_; //拥有Poll的EventLoop对象的指针
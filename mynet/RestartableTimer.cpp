@@ -0,0 +1,54 @@
+#include "mynet/RestartableTimer.h"
+#include "mynet/EventLoop.h"
+
+RestartableTimer::RestartableTimer(EventLoop *loop, double timeout)
+    : loop_(loop),
+      timeout_(timeout),
+      slack_(0.0),
+      timerId_(nullptr, 0),
+      armed_(false)
+{
+}
+
+RestartableTimer::~RestartableTimer()
+{
+    cancel();
+}
+
+void RestartableTimer::restart(MonoTimestamp now)
+{
+    loop_->assertInLoopThread();
+    MonoTimestamp when = addTime(now, timeout_);
+    if (armed_)
+    {
+        loop_->extendTimer(timerId_, when);
+    }
+    else
+    {
+        timerId_ = loop_->runAt(when, [this]() { handleExpired(); }, slack_);
+        armed_ = true;
+    }
+}
+
+void RestartableTimer::restart()
+{
+    restart(loop_->monoNow());
+}
+
+void RestartableTimer::cancel()
+{
+    if (armed_)
+    {
+        loop_->cancel(timerId_);
+        armed_ = false;
+    }
+}
+
+void RestartableTimer::handleExpired()
+{
+    armed_ = false; // 回调中可以再restart()
+    if (callback_)
+    {
+        callback_();
+    }
+}
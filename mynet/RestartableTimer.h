@@ -0,0 +1,41 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "base/MonoTimestamp.h"
+#include "mynet/Callbacks.h"
+#include "mynet/TimerId.h"
+
+class EventLoop;
+
+/**
+ * 可以反复重置的单次定时器 用于空闲超时/心跳超时这类"一有动静就往后推"的场合
+ * 还在计时时restart()只调用EventLoop::extendTimer修改到期时刻: 不分配Timer 不投递任务 不碰timerfd
+ * 定时器按原来的时刻到期时才发现被推迟过 重新排序一次 所以每个超时周期最多多醒来一次
+ * 到期后再restart()才重新添加定时器; 只能在loop线程中使用 必须在loop线程中析构
+ */
+class RestartableTimer : noncopyable
+{
+public:
+    RestartableTimer(EventLoop *loop, double timeout);
+    ~RestartableTimer();
+
+    void setCallback(TimerCallback cb) { callback_ = std::move(cb); }
+    void setTimeout(double timeout) { timeout_ = timeout; } // 下一次restart()起生效
+    double timeout() const { return timeout_; }
+    void setSlack(double slack) { slack_ = slack; } // 允许晚触发的秒数 见EventLoop::runAt; 下一次添加定时器时生效
+
+    void restart(MonoTimestamp now); // 从now起timeout秒后到期
+    void restart(); // 从本轮的EventLoop::monoNow()起计时
+    void cancel();
+    bool armed() const { return armed_; }
+
+private:
+    void handleExpired();
+
+    EventLoop *loop_;
+    double timeout_;
+    double slack_;
+    TimerCallback callback_;
+    TimerId timerId_;
+    bool armed_; // timerId_对应的定时器还没到期
+};
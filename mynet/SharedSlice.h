@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string.h>
+
+/**
+ * 不可变的引用计数数据 可以同时挂在很多连接的输出队列中 每个连接只多一个引用 不拷贝内容
+ * 用于广播: 同一条消息推给成千上万个连接时 内存是O(消息大小)而不是O(消息大小 x 连接数)
+ * 拷贝SharedSlice只增加引用计数 可以跨线程传递; 最后一个引用(通常是最慢的那个连接)发送完时释放
+ */
+class SharedSlice
+{
+public:
+    SharedSlice() : data_(nullptr), size_(0) {}
+
+    // 接管message 不拷贝内容
+    explicit SharedSlice(std::string &&message)
+    {
+        auto str = std::make_shared<const std::string>(std::move(message));
+        data_ = str->data();
+        size_ = str->size();
+        owner_ = std::move(str);
+    }
+
+    // 拷贝一次 之后所有的连接共享这一份
+    SharedSlice(const void *data, size_t len) : data_(nullptr), size_(len)
+    {
+        std::shared_ptr<char[]> copy(new char[len]);
+        memcpy(copy.get(), data, len);
+        data_ = copy.get();
+        owner_ = std::move(copy);
+    }
+
+    // owner保证[data, data + len)在所有引用存在期间有效并且不再修改
+    SharedSlice(std::shared_ptr<const void> owner, const char *data, size_t len)
+        : owner_(std::move(owner)), data_(data), size_(len)
+    {
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    long useCount() const { return owner_.use_count(); } // 还有多少个引用(包括排队中的切片)
+    const std::shared_ptr<const void> &owner() const { return owner_; }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const char *data_;
+    size_t size_;
+};
@@ -5,6 +5,11 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h> //tcp_info
 #include <stdio.h>       //snprinf
+#include <sys/socket.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60 // 旧的glibc头文件里没有 内核4.14开始支持
+#endif
 
 Socket::~Socket()
 {
@@ -78,21 +83,21 @@ void Socket::shutdownWrite()
 void Socket::setTcpNoDelay(bool on)
 {
     int optval = on ? 1 : 0;
-    int optlen = static_cast<socklen_t>(optval);
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
     setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &optval, optlen);
 }
 
 void Socket::setReuseAddr(bool on)
 {
     int optval = on ? 1 : 0;
-    int optlen = static_cast<socklen_t>(optval);
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
     setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &optval, optlen);
 }
 
 void Socket::setReusePort(bool on)
 {
     int optval = on ? 1 : 0;
-    int optlen = static_cast<socklen_t>(optval);
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
     int ret = setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &optval, optlen);
     if (ret < 0 && on)
     {
@@ -103,6 +108,18 @@ void Socket::setReusePort(bool on)
 void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
-    int optlen = static_cast<socklen_t>(optval);
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
     setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, optlen);
 }
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
+    int ret = setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, optlen);
+    if (ret < 0 && on)
+    {
+        LOG_SYSERR << "SO_ZEROCOPY failed.";
+    }
+    return ret == 0;
+}
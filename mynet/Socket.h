@@ -41,4 +41,6 @@ public:
     void setReusePort(bool on);
     /// Enable/disable SO_KEEPALIVE
     void setKeepAlive(bool on);
+    /// Enable/disable SO_ZEROCOPY, returns false if the kernel does not support it
+    bool setZeroCopy(bool on);
 };
@@ -9,6 +9,9 @@
 #include <unistd.h>
 #include <assert.h>
 #include <string.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 using SA = sockaddr;
 
@@ -89,12 +92,16 @@ void sockets::listenOrDie(int sockfd)
 int sockets::accept(int sockfd, sockaddr_in6 *addr)
 {
     socklen_t addrlen = static_cast<socklen_t>(sizeof *addr);
-    int connfd = ::accept(sockfd, sockaddr_cast(addr), &addrlen); // accept4()函数共有4个参数，相比accept()多了一个flags的参数，用户可以通过此参数直接设置套接字的一些属性，如SOCK_NONBLOCK或者是SOCK_CLOEXEC。当accept4的flags为0的时候，accept4和accept没有区别。
-    setNonBlockAndCloseOnExec(connfd);
+    // accept4()函数共有4个参数，相比accept()多了一个flags的参数，用户可以通过此参数直接设置套接字的一些属性，如SOCK_NONBLOCK或者是SOCK_CLOEXEC。
+    // 一次系统调用完成 不用再两次fcntl
+    int connfd = ::accept4(sockfd, sockaddr_cast(addr), &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd < 0)
     {
         int savedErrno = errno;
-        LOG_SYSERR << "Socket::accept";
+        if (savedErrno != EAGAIN) // Acceptor一直accept到EAGAIN为止 这是正常的结束
+        {
+            LOG_SYSERR << "Socket::accept";
+        }
         switch (savedErrno)
         {
         case EAGAIN:
@@ -159,6 +166,12 @@ size_t sockets::write(int sockfd, const void *buf, size_t count)
     return ::write(sockfd, buf, count);
 }
 
+// 把多块不连续的内存一次写入fd iovcnt不能超过IOV_MAX
+ssize_t sockets::writev(int sockfd, const iovec *iov, int iovcnt)
+{
+    return ::writev(sockfd, iov, iovcnt);
+}
+
 void sockets::close(int sockfd)
 {
     if (::close(sockfd) < 0)
@@ -248,6 +261,40 @@ int sockets::getSocketError(int sockfd) //
     }
     return optval;
 }
+int sockets::readZeroCopyCompletions(int sockfd, const std::function<void(uint32_t lo, uint32_t hi, bool copied)> &cb)
+{
+    int notified = 0;
+    char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+    for (;;)
+    {
+        msghdr msg;
+        bzero(&msg, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            break; // EAGAIN: 读空了
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const sock_extended_err *serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+            {
+                continue;
+            }
+            // [ee_info, ee_data]是完成的发送序号区间
+            cb(serr->ee_info, serr->ee_data, (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+            ++notified;
+        }
+    }
+    return notified;
+}
+
 //通过::getsockname调用获取本机地址信息
 sockaddr_in6 sockets::getLocalAddr(int sockfd) // 获取sockfd的本地ip地址
 {
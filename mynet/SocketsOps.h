@@ -1,5 +1,7 @@
 #pragma once 
 #include<arpa/inet.h>
+#include <functional>
+#include <stdint.h>
 //全局函数
 //封装了socket套接字生命流程中的相关的系统调用
 namespace sockets
@@ -13,6 +15,7 @@ namespace sockets
     size_t read(int sockfd,void *buf,size_t count);
     size_t readv(int sockfd,const iovec *iov, int iovcnt);
     size_t write(int sockfd, const void* buf,  size_t count);
+    ssize_t writev(int sockfd, const iovec *iov, int iovcnt);
     void close(int sockfd);
     void shutdownWrite(int sockfd);
     void toIpPort(char* buf,size_t size,const sockaddr* addr);
@@ -21,6 +24,9 @@ namespace sockets
     void fromIpPort(const char* ip,uint16_t port, sockaddr_in6* addr);
 
     int getSocketError(int sockfd);
+    // 读空错误队列 每个零拷贝完成通知回调一次: 序号区间[lo, hi] copied表示内核实际上还是拷贝了
+    // 返回零拷贝通知的个数 为0说明错误队列里没有通知(真正的socket错误或者什么都没有)
+    int readZeroCopyCompletions(int sockfd, const std::function<void(uint32_t lo, uint32_t hi, bool copied)> &cb);
 
     const sockaddr* sockaddr_cast(const sockaddr_in* addr);
     const sockaddr* sockaddr_cast(const sockaddr_in6* addr);
@@ -3,6 +3,14 @@
 #include "base/WeakCallback.h"
 #include "mynet/EventLoop.h"
 #include "mynet/SocketsOps.h"
+#include "mynet/ZeroCopyGraveyard.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn)
 {
@@ -21,47 +29,101 @@ TcpConnection::TcpConnection(EventLoop *loop,
                              int sockfd,
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
+    : TcpConnection(loop, 0, nullptr, name, sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                             uint64_t id,
+                             std::shared_ptr<const std::string> namePrefix,
+                             int sockfd,
+                             const InetAddress &localAddr,
+                             const InetAddress &peerAddr)
+    : TcpConnection(loop, id, std::move(namePrefix), std::string(), sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                             uint64_t id,
+                             std::shared_ptr<const std::string> namePrefix,
+                             const std::string &name,
+                             int sockfd,
+                             const InetAddress &localAddr,
+                             const InetAddress &peerAddr)
     : loop_(loop),
+      id_(id),
+      namePrefix_(std::move(namePrefix)),
       name_(name),
       state_(kConnecting),
       reading_(true),
-      socket_(new Socket(sockfd)),
-      channel_(new Channel(loop, sockfd)),
+      completionMode_(false),
+      edgeTriggered_(false),
+      recvPending_(false),
+      sendPending_(false),
+      socket_(sockfd),
+      channel_(loop, sockfd),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024) // 64MB
+      highWaterMark_(64 * 1024 * 1024), // 64MB
+      zeroCopyThreshold_(0),
+      zeroCopyCompletions_(0),
+      zeroCopyCopied_(0),
+      outputQueue_(loop->blockPool()),
+      idleTimer_(loop, 0.0)
 
 {
-    channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
-    socket_->setKeepAlive(true);
+    channel_.setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
+    channel_.setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
+    channel_.setCloseCallback(std::bind(&TcpConnection::handleClose, this));
+    channel_.setErrorCallback(std::bind(&TcpConnection::handleError, this));
+    channel_.setRecvCompleteCallback(std::bind(&TcpConnection::handleRecvComplete, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    channel_.setSendCompleteCallback(std::bind(&TcpConnection::handleSendComplete, this, std::placeholders::_1));
+    socket_.setKeepAlive(true);
+    loop_->connectionCreated();
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at" << this << " fd =" << channel_->fd()
+    LOG_DEBUG << "TcpConnection::dtor[" << name() << "] at" << this << " fd =" << channel_.fd()
               << " state = " << stateToString();
     assert(state_ == kDisconnected);
 }
 
+std::string TcpConnection::name() const
+{
+    if (namePrefix_)
+    {
+        return *namePrefix_ + std::to_string(id_);
+    }
+    return name_;
+}
+
 bool TcpConnection::getTcpInfo(tcp_info *tcpi) const
 { // getsockopt获得tcp的信息
-    return socket_->getTcpInfo(tcpi);
+    return socket_.getTcpInfo(tcpi);
 }
 
 std::string TcpConnection::getTcpInfoString() const
 {
     char buff[1024];
     buff[0] = '\0';
-    socket_->getTcpInfoString(buff, sizeof buff);
+    socket_.getTcpInfoString(buff, sizeof buff);
     return buff;
 }
 
 void TcpConnection::send(const void *message, size_t len)
 {
-    send(std::string(static_cast<const char *>(message), len));
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(message, len);
+        }
+        else
+        {
+            send(std::string(static_cast<const char *>(message), len)); // 跨线程只能拷贝一次
+        }
+    }
 }
 
 //线程安全 可以跨线程调用
@@ -76,7 +138,7 @@ void TcpConnection::send(const std::string &message)
         else
         {                                                                                       // 对于有重载的函数的绑定 需要显示的指出被绑定成员函数的类型
             void (TcpConnection::*fp)(const std::string &message) = &TcpConnection::sendInLoop; // fixme
-            loop_->runInLoop(std::bind(fp, this, message));//这里拷贝message会带来一定开销
+            loop_->runInLoop(std::bind(fp, this, message));//这里拷贝message会带来一定开销 不需要保留message时用send(std::move(message))
         }
     }
 }
@@ -91,10 +153,98 @@ void TcpConnection::send(Buffer *buf)
             buf->retrieveAll();
         }
         else
-        {                                                                                                              // bind不能绑定重载了的函数
-            void (TcpConnection::*fp /*这是个函数指针别名*/)(const std::string &message) = &TcpConnection::sendInLoop; // 因为sendInLoop是一个重载了的函数 需要用声明新的函数指针明确其调用的是哪一个
-            loop_->runInLoop(std::bind(fp, this, buf->retrieveAllAsString()));                                         //
-            // std::bind(&TcpConnection::sendInLoop, this, buf->retrieveAllAsString()); 会报错  因为sendInLoop是重载了的函数
+        { // 原先是retrieveAllAsString()拷贝一次 现在直接把底层存储交换出来
+            Buffer payload(0);
+            payload.swap(*buf);
+            send(std::move(payload));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(OutputSlice(std::move(message)));
+        }
+        else
+        { // 长字符串的移动只是转移指针 任务(this + string)放得进InplaceTask 也不分配内存
+            loop_->runInLoop([this, message = std::move(message)]() mutable
+                             { sendInLoop(OutputSlice(std::move(message))); });
+        }
+    }
+}
+
+void TcpConnection::send(Buffer &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(OutputSlice(std::move(buf)));
+        }
+        else
+        {
+            Buffer payload(0);
+            payload.swap(buf);
+            loop_->runInLoop([this, payload = std::move(payload)]() mutable
+                             { sendInLoop(OutputSlice(std::move(payload))); });
+        }
+    }
+}
+
+void TcpConnection::send(std::unique_ptr<char[]> data, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(OutputSlice(std::move(data), len));
+        }
+        else
+        { // 只能移动的任务 依赖EventLoop::Functor是InplaceTask
+            loop_->runInLoop([this, data = std::move(data), len]() mutable
+                             { sendInLoop(OutputSlice(std::move(data), len)); });
+        }
+    }
+}
+
+void TcpConnection::send(const SharedSlice &message)
+{
+    if (state_ == kConnected && !message.empty())
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(OutputSlice(message));
+        }
+        else
+        {
+            loop_->runInLoop([this, message]()
+                             { sendInLoop(OutputSlice(message)); });
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected && len > 0)
+    {
+        int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0); // 发送可能持续很久 不依赖调用方fd的生命期
+        if (dupfd < 0)
+        {
+            LOG_SYSERR << "TcpConnection::sendFile";
+            return;
+        }
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(OutputSlice(FileRange(dupfd), offset, len));
+        }
+        else
+        {
+            loop_->runInLoop([this, file = FileRange(dupfd), offset, len]() mutable
+                             { sendFileInLoop(OutputSlice(std::move(file), offset, len)); });
         }
     }
 }
@@ -126,7 +276,7 @@ void TcpConnection::forceCloseWithDelay(double second)
 
 void TcpConnection::setTcpNoDelay(bool on)
 {
-    socket_->setTcpNoDelay(on);
+    socket_.setTcpNoDelay(on);
 }
 
 void TcpConnection::startRead()
@@ -145,8 +295,33 @@ void TcpConnection::connectEstablished()
     loop_->assertInLoopThread();
     assert(state_ == kConnecting);
     setState(kConnected);
-    channel_->tie(shared_from_this()); //将当前conn对象新的share对象赋值给tie tie是弱引用
-    channel_->enableReading();
+    channel_.tie(shared_from_this()); //将当前conn对象新的share对象赋值给tie tie是弱引用
+    completionMode_ = completionMode_ && loop_->completionIoSupported();
+    edgeTriggered_ = edgeTriggered_ && !completionMode_ && loop_->edgeTriggerSupported();
+    if (completionMode_)
+    { // 完成模式不关注可读事件 直接提交一个异步recv
+        loop_->submitRecv(&channel_);
+        recvPending_ = true;
+    }
+    else if (edgeTriggered_)
+    { // 读写事件只在这里注册一次 之后的读写都不再修改关注的事件
+        channel_.setEdgeTriggered(true);
+        channel_.enableAll();
+    }
+    else
+    {
+        channel_.enableReading();
+    }
+    if (zeroCopyThreshold_ > 0 && !completionMode_ && socket_.setZeroCopy(true))
+    { // 完成通知从错误队列读 Poller总会报告POLLERR 不需要额外关注事件
+        outputQueue_.setZeroCopyThreshold(zeroCopyThreshold_);
+        channel_.setErrorQueueCallback(std::bind(&TcpConnection::handleErrorQueue, this));
+    }
+    if (idleTimer_.timeout() > 0)
+    { // 定时器由连接持有 连接析构前在connectDestroyed中取消; 弱回调防止回调期间连接已经被移除
+        idleTimer_.setCallback(makeWeakCallback(shared_from_this(), &TcpConnection::handleIdleTimeout));
+        idleTimer_.restart();
+    }
     connectionCallback_(shared_from_this());
 }
 
@@ -154,23 +329,44 @@ void TcpConnection::connectEstablished()
 void TcpConnection::connectDestroyed()
 {
     loop_->assertInLoopThread();
-    if (state_ == kConnected)
+    if (state_ == kConnected || state_ == kDisconnecting) // shutdown()之后对端还没关闭时 channel同样还在关注事件
     {
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
         connectionCallback_(shared_from_this());
     }
-    channel_->remove();
+    channel_.remove();
+    if (outputQueue_.pinnedSlices() > 0)
+    { // 还有零拷贝发送没等到完成通知: socket关闭后内核仍可能重传这些页面 内存连同一份socket交给loop等通知
+        int fd = ::fcntl(channel_.fd(), F_DUPFD_CLOEXEC, 0);
+        if (fd >= 0)
+        {
+            loop_->zeroCopyGraveyard()->adopt(fd, outputQueue_.releasePinned());
+        }
+        else
+        {
+            LOG_SYSERR << "TcpConnection::connectDestroyed dup"; // 只能随连接一起提前释放
+        }
+    }
+    outputQueue_.retrieveAll(); // 未发送的块在loop线程中还给BlockPool 连接对象可能在其他线程析构
+    idleTimer_.cancel(); // 同理 定时器必须在loop线程中取消
+    loop_->connectionDestroyed(); // 析构可能晚于loop 在这里计数
 }
 
 //channel可读事件触发时 读客户端发来的数据 读到输入缓冲区内
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
     loop_->assertInLoopThread();
+    if (edgeTriggered_)
+    {
+        handleReadEdge(receiveTime);
+        return;
+    }
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno);
     if (n > 0)
     {
+        touch();
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
     }
     else if (n == 0) //被动关闭连接 读到0说明客户端关闭 调用handleClose
@@ -189,35 +385,117 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 void TcpConnection::handleWrite()
 {
     loop_->assertInLoopThread();
-    if (channel_->isWriting())
+    if (edgeTriggered_)
+    {
+        handleWriteEdge();
+        return;
+    }
+    if (channel_.isWriting())
     {
-        // 把输出缓冲区的可读数据写入管道 输出缓冲区数据来源于应用层 输出至管道
-        ssize_t n = sockets::write(channel_->fd(), outputBuffer_.peek(), outputBuffer_.readableBytes());
+        // 把输出队列中的数据用writev写入管道 输出队列数据来源于应用层 输出至管道
+        int savedErrno = 0;
+        ssize_t n = outputQueue_.writeFd(channel_.fd(), &savedErrno);
+        if (n < 0)
+        {
+            errno = savedErrno;
+            LOG_SYSERR << "TcpConnection::handleWrite";
+        }
+        // 不只看n: 截断的文件区间被丢弃时n为0 队列也可能就此变空
+        if (outputQueue_.empty()) // 输出队列为空即没有数据需要输出到网络时 要写事件取消关注
+        {
+            handleOutputDrained();
+        }
+    }
+    else
+    {
+        LOG_TRACE << "Connection fd = " << channel_.fd()
+                  << " is down, no more writing";
+    }
+}
+
+//边沿触发: 一次通知之后必须读到EAGAIN 否则剩下的数据不会再有通知
+//每读一次就回调一次messageCallback_ 和电平触发时多次唤醒的效果一样 用户可以及时消费输入缓冲区
+void TcpConnection::handleReadEdge(Timestamp receiveTime)
+{
+    // 回调中可能stopRead或者关闭连接; stopRead期间剩下的数据由startRead补读
+    // shutdown()之后(kDisconnecting)也要继续读: 对端的FIN和数据一起以POLLIN|POLLHUP到来 不读到0就没有人关闭连接 边沿触发也不会再通知
+    while (reading_ && (state_ == kConnected || state_ == kDisconnecting))
+    {
+        int savedErrno = 0;
+        ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno);
         if (n > 0)
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0) // 输出缓冲区可读为0即没有数据需要输出到网络时 要写事件取消关注
+            touch();
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        }
+        else if (n == 0)
+        {
+            handleClose();
+            break;
+        }
+        else if (savedErrno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
             {
-                channel_->disableWriting(); // 处理完可写数据后要把 写事件取消关注 否则会busy loop 因为是LT模式
-                if (writecompleteCallback_) 
-                {
-                    loop_->queueInLoop(std::bind(writecompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting) //这里对应的是shutdown里 如果检查当时conn还在写，那么只将状态改为kDisconnecting,待写完以后shundown
-                {
-                    shundownInLoop();
-                }
+                errno = savedErrno;
+                LOG_SYSERR << "TcpConnection::handleReadEdge";
+                handleError();
             }
+            break;
+        }
+    }
+}
+
+//边沿触发: socket重新变为可写 把输出缓冲区写到空或者EAGAIN为止 不需要关注/取消关注写事件
+void TcpConnection::handleWriteEdge()
+{
+    if (outputQueue_.empty() || state_ == kDisconnected)
+    {
+        return; // 读事件也会带上EPOLLOUT 没有待发送的数据时直接返回
+    }
+    while (!outputQueue_.empty())
+    {
+        int savedErrno = 0;
+        ssize_t n = outputQueue_.writeFd(channel_.fd(), &savedErrno);
+        if (n >= 0)
+        {
+            continue; // 0: 丢弃了截断的文件区间 后面的数据接着发
+        }
+        else if (n < 0 && savedErrno == EINTR)
+        {
+            continue;
         }
         else
         {
-            LOG_SYSERR << "TcpConnection::handleWrite";
+            if (savedErrno != EWOULDBLOCK)
+            {
+                errno = savedErrno;
+                LOG_SYSERR << "TcpConnection::handleWriteEdge";
+            }
+            return; // 内核发送缓冲区满了 等下一次EPOLLOUT边沿
         }
     }
-    else
+    handleOutputDrained();
+}
+
+//输出队列刚刚写空: 电平触发时取消关注写事件 回调写完成 shutdown()在等待写完时现在关闭写端
+void TcpConnection::handleOutputDrained()
+{
+    if (!edgeTriggered_)
     {
-        LOG_TRACE << "Connection fd = " << channel_->fd()
-                  << " is down, no more writing";
+        channel_.disableWriting(); // 处理完可写数据后要把 写事件取消关注 否则会busy loop 因为是LT模式
+    }
+    if (writecompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writecompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting) //这里对应的是shutdown里 如果检查当时conn还在写，那么只将状态改为kDisconnecting,待写完以后shundown
+    {
+        shundownInLoop();
     }
 }
 
@@ -225,10 +503,10 @@ void TcpConnection::handleWrite()
 void TcpConnection::handleClose() 
 {
     loop_->assertInLoopThread();
-    LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
-    assert(state_ == kConnected || state_ == kConnecting);
+    LOG_TRACE << "fd = " << channel_.fd() << " state = " << stateToString();
+    assert(state_ == kConnected || state_ == kDisconnecting);
     setState(kDisconnected);
-    channel_->disableAll(); // 每个连接有一个连接套接字，在连接断开前，套接字对应的channel还在poller的关注列表中，所以handleClose需要将当前channel对象的所有事件取消关注
+    channel_.disableAll(); // 每个连接有一个连接套接字，在连接断开前，套接字对应的channel还在poller的关注列表中，所以handleClose需要将当前channel对象的所有事件取消关注
 
     // fixme
     TcpConnectionPtr guradThis(shared_from_this()); //this对象的计数引用+1 直到执行完handleClose
@@ -241,36 +519,249 @@ void TcpConnection::handleClose()
 //处理错误
 void TcpConnection::handleError()
 {
-    int err = sockets::getSocketError(channel_->fd());
-    LOG_ERROR << "TcpConnection::handleError [" << name_
+    int err = sockets::getSocketError(channel_.fd());
+    LOG_ERROR << "TcpConnection::handleError [" << name()
               << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
 
+//零拷贝: 读空socket的错误队列 释放完成通知覆盖的那些发送所保留的内存
+//错误队列中没有零拷贝通知时 说明是真正的socket错误 按原来的方式处理
+void TcpConnection::handleErrorQueue()
+{
+    loop_->assertInLoopThread();
+    int notified = sockets::readZeroCopyCompletions(channel_.fd(), [this](uint32_t lo, uint32_t hi, bool copied)
+                                                    {
+                                                        outputQueue_.completeZeroCopy(lo, hi);
+                                                        zeroCopyCompletions_ += hi - lo + 1;
+                                                        if (copied)
+                                                        {
+                                                            zeroCopyCopied_ += hi - lo + 1;
+                                                        }
+                                                    });
+    if (notified == 0)
+    {
+        handleError();
+    }
+}
+
+//完成模式: 异步recv完成 数据在Poller的接收缓冲区中 只在本回调期间有效
+void TcpConnection::handleRecvComplete(const char *data, ssize_t n, Timestamp receiveTime)
+{
+    loop_->assertInLoopThread();
+    recvPending_ = false;
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (n > 0)
+    {
+        touch();
+        inputBuffer_.append(data, n);
+        if (reading_)
+        { // 先提交下一次recv 让内核在用户处理消息的同时继续接收
+            loop_->submitRecv(&channel_);
+            recvPending_ = true;
+        }
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+    else if (n == 0)
+    {
+        handleClose();
+    }
+    else if (n == -ENOBUFS)
+    { // 接收缓冲区环暂时耗尽 下一轮poll()归还缓冲区后再提交
+        if (reading_)
+        {
+            loop_->submitRecv(&channel_);
+            recvPending_ = true;
+        }
+    }
+    else
+    {
+        errno = static_cast<int>(-n);
+        LOG_SYSERR << "TcpConnection::handleRecvComplete";
+        handleError();
+        handleClose();
+    }
+}
+
+//完成模式: 异步send完成 继续发送输出缓冲区中剩余的数据
+void TcpConnection::handleSendComplete(ssize_t n)
+{
+    loop_->assertInLoopThread();
+    sendPending_ = false;
+    if (n < 0)
+    {
+        errno = static_cast<int>(-n);
+        LOG_SYSERR << "TcpConnection::handleSendComplete";
+        // 发送失败后剩下的数据再也发不出去 丢弃并关闭连接(与handleRecvComplete出错时一样) 否则队列残留 之后的send()会乱序
+        outputQueue_.retrieveAll();
+        if (state_ == kConnected || state_ == kDisconnecting)
+        {
+            handleError();
+            handleClose();
+        }
+        return;
+    }
+    if (!outputQueue_.empty())
+    {
+        submitSendInLoop();
+    }
+    else
+    {
+        if (writecompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writecompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shundownInLoop();
+        }
+    }
+}
+
+// 把输出队列队首的一段数据交给Poller发送(Poller拷贝进自己的发送块) 同时只有一个send在进行
+void TcpConnection::submitSendInLoop()
+{
+    assert(!sendPending_ && !outputQueue_.empty());
+    const OutputSlice &front = outputQueue_.front();
+    size_t n = 0;
+    if (front.isFile())
+    { // io_uring这里没有sendfile 只能先读一块到用户态 只有完成模式会多这一次拷贝
+        char buf[64 * 1024];
+        ssize_t nread = ::pread(front.fileFd(), buf, std::min(front.size(), sizeof buf), front.fileOffset());
+        if (nread <= 0)
+        {
+            LOG_SYSERR << "TcpConnection::submitSendInLoop pread";
+            outputQueue_.retrieve(front.size()); // 读不出来(出错或者文件被截断)的区间丢弃
+            if (!outputQueue_.empty())
+            {
+                submitSendInLoop();
+            }
+            return;
+        }
+        n = loop_->submitSend(&channel_, buf, nread);
+    }
+    else
+    {
+        n = loop_->submitSend(&channel_, front.data(), front.size());
+    }
+    outputQueue_.retrieve(n);
+    sendPending_ = true;
+}
+
 void TcpConnection::sendInLoop(const std::string &message)
 {
     sendInLoop(message.data(), message.size());
 }
 
 void TcpConnection::sendInLoop(const void *data, size_t len)
+{
+    ssize_t nwrote = trySendInLoop(static_cast<const char *>(data), len);
+    if (nwrote >= 0 && static_cast<size_t>(nwrote) < len)
+    { // 调用方保留数据的所有权 剩下的部分只能拷贝进输出队列
+        size_t oldLen = outputQueue_.memoryBytes();
+        outputQueue_.append(static_cast<const char *>(data) + nwrote, len - nwrote);
+        queueOutputInLoop(oldLen);
+    }
+}
+
+void TcpConnection::sendInLoop(OutputSlice &&slice)
+{
+    if (outputQueue_.zeroCopyEligible(slice))
+    { // 零拷贝发送由输出队列完成 它要在发送成功后保留这块内存
+        queueAndFlushInLoop(std::move(slice), "TcpConnection::sendInLoop");
+        return;
+    }
+    ssize_t nwrote = trySendInLoop(slice.data(), slice.size());
+    if (nwrote >= 0 && static_cast<size_t>(nwrote) < slice.size())
+    {
+        slice.retrieve(nwrote);
+        size_t oldLen = outputQueue_.memoryBytes();
+        outputQueue_.append(std::move(slice));
+        queueOutputInLoop(oldLen);
+    }
+}
+
+void TcpConnection::sendFileInLoop(OutputSlice &&file)
+{
+    queueAndFlushInLoop(std::move(file), "TcpConnection::sendFileInLoop");
+}
+
+void TcpConnection::queueAndFlushInLoop(OutputSlice &&slice, const char *where)
+{
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    bool idle = outputQueue_.empty();
+    size_t oldLen = outputQueue_.memoryBytes();
+    outputQueue_.append(std::move(slice));
+    if (!idle)
+    { // 前面还有数据在排队 已经在等可写事件或者异步发送完成 轮到这一段时自然会发送
+        return;
+    }
+    if (completionMode_)
+    {
+        if (!sendPending_)
+        {
+            submitSendInLoop();
+        }
+        return;
+    }
+    // 与trySendInLoop一样 输出队列原本为空时先直接发送一次
+    int savedErrno = 0;
+    ssize_t n = outputQueue_.writeFd(channel_.fd(), &savedErrno);
+    if (n < 0 && savedErrno != EWOULDBLOCK)
+    {
+        errno = savedErrno;
+        LOG_SYSERR << where;
+        if (savedErrno == EPIPE || savedErrno == ECONNRESET)
+        {
+            outputQueue_.retrieveAll();
+            return;
+        }
+    }
+    if (outputQueue_.empty())
+    {
+        if (writecompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writecompleteCallback_, shared_from_this()));
+        }
+        return;
+    }
+    queueOutputInLoop(oldLen);
+}
+
+ssize_t TcpConnection::trySendInLoop(const char *data, size_t len)
 {
     loop_->assertInLoopThread();
     ssize_t nwrote = 0; // 已发送字节数
-    size_t remaining = len;
-    bool faultError = false;
     if (state_ == kDisconnected)
     {
         LOG_WARN << "disconnected, givp up writing";
-        return;
+        return -1;
+    }
+
+    if (completionMode_)
+    {
+        if (!sendPending_ && outputQueue_.empty())
+        { // 没有进行中的发送 直接从用户数据拷贝到发送块 免去一次经过输出队列的拷贝
+            nwrote = loop_->submitSend(&channel_, data, len);
+            sendPending_ = true;
+        }
+        return nwrote; // 队列里还有数据时返回0 由调用方排在后面 queueOutputInLoop再提交 保证顺序
     }
 
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if ((edgeTriggered_ || !channel_.isWriting()) && outputQueue_.empty())
     {
-        // 如果输出缓冲区为空（没有其他待写数据 尝试直接向内核缓冲区写 若能够写完说明不需要输出缓冲区，也不需要再关注写事件）
-        nwrote = sockets::write(channel_->fd(), data, len);
+        // 如果输出队列为空（没有其他待写数据 尝试直接向内核缓冲区写 若能够写完说明不需要输出队列，也不需要再关注写事件）
+        nwrote = sockets::write(channel_.fd(), data, len);
         if (nwrote >= 0)
         {
-            remaining = remaining - nwrote;
-            if (remaining == 0 && writecompleteCallback_)
+            if (static_cast<size_t>(nwrote) == len && writecompleteCallback_)
             {
                 loop_->runInLoop(bind(writecompleteCallback_, shared_from_this()));
             }
@@ -283,45 +774,60 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
                 LOG_SYSERR << "TcpConnection::sendInLoop";
                 if (errno == EPIPE || errno == ECONNRESET) // 管道破裂或者连接RST 造成原因可能是客户端掉线/或者对端重启连接，还未建立连接
                 {
-                    faultError = true;
+                    return -1; // 剩下的数据不再放进输出队列
                 }
             }
         }
     }
+    return nwrote;
+}
 
-    assert(remaining <= len);
-    if (!faultError && remaining > 0)
-    { // 没有发生EPIPE错误或ECONNRESET错误 且待写内容还不为空时说明内核写缓冲区满了 要将剩余的数据写入output缓冲区
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highwatermarkCallback_)//如果应用层的output缓冲区已有内容超过高水位警戒线 并且设置了highwatermarkCallback_
-        {       //则调用highwatermarkCallback_处理
-            loop_->queueInLoop(bind(highwatermarkCallback_,shared_from_this(),oldLen + remaining));
-        }
-        outputBuffer_.append(static_cast<const char*>(data)+nwrote,remaining);
-        if(!channel_->isWriting()){
-            channel_->enableReading(); //如果应用层输出缓冲区有数据 那么需要关注pullout事件
+void TcpConnection::queueOutputInLoop(size_t oldLen)
+{
+    size_t newLen = outputQueue_.memoryBytes(); // 文件区间不占内存 不计入高水位
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highwatermarkCallback_)//如果应用层的输出队列已有内容超过高水位警戒线 并且设置了highwatermarkCallback_
+    {       //则调用highwatermarkCallback_处理
+        loop_->queueInLoop(bind(highwatermarkCallback_, shared_from_this(), newLen));
+    }
+    if (completionMode_)
+    {
+        if (!sendPending_ && !outputQueue_.empty())
+        { // 没有进行中的发送(trySendInLoop因队列非空没有提交) 从队首开始提交
+            submitSendInLoop();
         }
     }
+    else if (!edgeTriggered_ && !channel_.isWriting())
+    {
+        channel_.enableWriting(); //如果应用层输出队列有数据 那么需要关注pullout事件; 边沿触发时一直关注着 等EPOLLOUT边沿即可
+    }
 }
 
 void TcpConnection::shundownInLoop()
 {
     loop_->assertInLoopThread();
-    if (!channel_->isWriting())//若还在关注pullout事件 不能调用shutdownWirte
+    bool writing = edgeTriggered_ ? !outputQueue_.empty() : channel_.isWriting();
+    if (!writing && !sendPending_)//若还在关注pullout事件(边沿触发时是输出缓冲区非空)或者还有异步发送未完成 不能调用shutdownWirte
     {
-        socket_->shutdownWrite();//关闭写的这一半
+        socket_.shutdownWrite();//关闭写的这一半
     }
 }
 
 void TcpConnection::forceCloseInLoop()//主动关闭连接
 {
     loop_->assertInLoopThread();
-    if (state_ == kConnected || state_ == kConnecting)
+    if (state_ == kConnected || state_ == kDisconnecting) // forceClose()已经把状态改成了kDisconnecting
     {
         handleClose();
     }
 }
 
+void TcpConnection::handleIdleTimeout()
+{
+    loop_->assertInLoopThread();
+    LOG_DEBUG << "TcpConnection::handleIdleTimeout [" << name() << "] idle for " << idleTimer_.timeout() << "s";
+    forceClose();
+}
+
 const char *TcpConnection::stateToString() const
 {
     switch (state_)
@@ -342,9 +848,28 @@ const char *TcpConnection::stateToString() const
 void TcpConnection::startReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (!reading_ || !channel_->isReading())
+    if (completionMode_)
+    {
+        reading_ = true;
+        if (!recvPending_ && state_ == kConnected)
+        {
+            loop_->submitRecv(&channel_);
+            recvPending_ = true;
+        }
+        return;
+    }
+    if (edgeTriggered_)
+    { // 读事件一直关注着 但停止读期间到达的数据已经错过了边沿通知 所以补读一次
+        if (!reading_)
+        {
+            reading_ = true;
+            loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), Timestamp::now()));
+        }
+        return;
+    }
+    if (!reading_ || !channel_.isReading())
     { // 与这个connfd绑定的channel在loop中没有检测到读事件
-        channel_->enableReading();
+        channel_.enableReading();
         reading_ = true;
     }
 }
@@ -352,9 +877,14 @@ void TcpConnection::startReadInLoop()
 void TcpConnection::stopReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (reading_ || channel_->isReading())
+    if (completionMode_ || edgeTriggered_)
+    { // 完成模式: 已经提交的recv仍会完成 只是不再提交新的; 边沿触发: 不修改关注的事件 handleReadEdge看到reading_为false就不再读
+        reading_ = false;
+        return;
+    }
+    if (reading_ || channel_.isReading())
     {
-        channel_->disableReading();
+        channel_.disableReading();
         reading_ = false;
     }
 }
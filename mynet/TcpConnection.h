@@ -3,8 +3,10 @@
 #include "base/Noncopyable.h"
 #include "mynet/Callbacks.h"
 #include "mynet/Buffer.h"
+#include "mynet/OutputQueue.h"
 #include "mynet/InetAddress.h"
 #include "mynet/Channel.h"
+#include "mynet/RestartableTimer.h"
 #include "mynet/Socket.h"
 
 #include <any>
@@ -21,11 +23,14 @@ class TcpConnection : noncopyable, public enable_shared_from_this<TcpConnection>
 {
 public:
     TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
+    // TcpServer使用: 名字是namePrefix后接id 到调用name()时才拼出来 建立连接时不分配字符串; 同一个server的连接共用namePrefix
+    TcpConnection(EventLoop *loop, uint64_t id, std::shared_ptr<const std::string> namePrefix, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
     ~TcpConnection();
 
     EventLoop *getLoop() const { return loop_; }
 
-    const std::string &name() const { return name_; }
+    uint64_t id() const { return id_; } // 用名字构造的连接为0
+    std::string name() const;
     const InetAddress &localAddress() const { return localAddr_; }
     const InetAddress &peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
@@ -37,6 +42,15 @@ public:
     void send(const void *message, size_t len);
     void send(const std::string &message);
     void send(Buffer *message);
+    // 转移所有权的版本: 跨线程调用时把数据本身移进任务 不拷贝负载
+    void send(std::string &&message);
+    void send(Buffer &&message); // message被清空
+    void send(std::unique_ptr<char[]> data, size_t len);
+    // 引用计数的不可变数据: 排队时只增加引用 同一份数据可以同时挂在很多连接上(见TcpServer::broadcast)
+    void send(const SharedSlice &message);
+    // 发送文件fd的[offset, offset + len)区间 与之前send的数据按顺序排队 用sendfile(2)发送 内容不经过用户态
+    // 内部dup一份fd 调用返回后调用方即可关闭自己的fd; 发送完同样回调writecompleteCallback_ 文件区间不计入高水位
+    void sendFile(int fd, off_t offset, size_t len);
     void shutdown();
     void forceClose();
 
@@ -47,6 +61,34 @@ public:
     void stopRead();
     bool isReading() const { return reading_; }
 
+    // 完成模式: 用io_uring的异步recv/send代替"就绪通知+read/write"
+    // 必须在connectEstablished之前设置; loop的Poller不支持时自动退回就绪模式
+    void setCompletionMode(bool on) { completionMode_ = on; }
+    bool completionMode() const { return completionMode_; }
+
+    // 边沿触发模式: 连接建立时一次性注册EPOLLIN|EPOLLOUT|EPOLLET 之后不再用epoll_ctl修改关注的事件
+    // 读写都进行到EAGAIN为止; 必须在connectEstablished之前设置 Poller不支持时退回电平触发
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
+    // 零拷贝发送: 移交了所有权且不小于threshold字节的数据用SO_ZEROCOPY + send(MSG_ZEROCOPY)发送
+    // 内存保留到socket错误队列上的完成通知到来才释放; 0表示关闭(默认) 必须在connectEstablished之前设置
+    // 完成模式或者内核不支持时不开启; 调用方保留所有权的数据(const void *)仍然拷贝
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    bool zeroCopy() const { return outputQueue_.zeroCopyThreshold() > 0; }
+    uint64_t zeroCopyCompletions() const { return zeroCopyCompletions_; } // 已经完成通知的零拷贝发送次数
+    uint64_t zeroCopyCopied() const { return zeroCopyCopied_; } // 其中内核实际上还是拷贝了的次数(例如loopback)
+
+    // 空闲超时: 连续seconds秒没有收到数据就强制关闭连接 0表示不限(默认) 必须在connectEstablished之前设置
+    // 每次收到数据只推迟同一个定时器的到期时刻(RestartableTimer) 不分配也不投递任务
+    // slack秒: 允许晚关闭的时间 大量连接的超时可以合并成少数几次唤醒
+    void setIdleTimeout(double seconds, double slack = 0.0)
+    {
+        idleTimer_.setTimeout(seconds);
+        idleTimer_.setSlack(slack);
+    }
+    double idleTimeout() const { return idleTimer_.timeout(); }
+
     void setContext(const std::any &context) { context_ = context; };
     const std::any &getContext() const { return context_; };
     std::any *getMutableContext() { return &context_; }
@@ -82,9 +124,9 @@ public:
         return &inputBuffer_;
     }
 
-    Buffer *outputBuffer()
+    OutputQueue *outputQueue()
     {
-        return &outputBuffer_;
+        return &outputQueue_;
     }
 
     void connectEstablished(); // 只能调用一次
@@ -103,25 +145,53 @@ private:
     void handleRead(Timestamp receiveTime);
     void handleWrite();
     void handleClose();
+    void handleOutputDrained();
     void handleError();
+    void handleErrorQueue();
+    void handleReadEdge(Timestamp receiveTime);
+    void handleWriteEdge();
+    void handleRecvComplete(const char *data, ssize_t n, Timestamp receiveTime);
+    void handleSendComplete(ssize_t n);
+    void submitSendInLoop();
 
     void sendInLoop(const std::string &message);
     void sendInLoop(const void *message, size_t len);
+    void sendInLoop(OutputSlice &&slice); // 没能直接写完的部分整块挂到输出队列 不拷贝
+    void sendFileInLoop(OutputSlice &&file);
+    void queueAndFlushInLoop(OutputSlice &&slice, const char *where); // 整块挂到队尾 队列原本为空时立即发送一次
+    ssize_t trySendInLoop(const char *data, size_t len); // 输出队列为空时直接发送 返回发送的字节数 出错时返回-1
+    void queueOutputInLoop(size_t oldLen); // 数据进入输出队列之后: 检查高水位 关注可写事件
     void shundownInLoop();
 
     void forceCloseInLoop();
+    void handleIdleTimeout();
+    void touch() // 收到数据 推迟空闲超时
+    {
+        if (idleTimer_.armed())
+        {
+            idleTimer_.restart();
+        }
+    }
+    TcpConnection(EventLoop *loop, uint64_t id, std::shared_ptr<const std::string> namePrefix, const std::string &name,
+                  int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
     void setState(StateE s) { state_ = s; };
     const char *stateToString() const;
     void startReadInLoop();
     void stopReadInLoop();
 
     EventLoop *loop_;
+    const uint64_t id_;
+    const std::shared_ptr<const std::string> namePrefix_; // 为空时名字就是name_
     const std::string name_;
     StateE state_;
     bool reading_;
-    // 使用智能指针作为成员变量，被持有对象的类，是不可以进行前置声明的
-    std::unique_ptr<Socket> socket_;   // 封装了一个文件描述符以及对应的bind listen accep shutdownWritet等操作
-    std::unique_ptr<Channel> channel_; // 连接一个EventLoop和一个打开的文件描述符的桥梁 能够注册/删除文件描述符到loop 和设置相关的回调函数
+    bool completionMode_;
+    bool edgeTriggered_;
+    bool recvPending_; // 完成模式下是否有已提交未完成的recv/send
+    bool sendPending_;
+    // 直接嵌在连接对象里 不单独分配 TcpServer把连接整个从loop的connectionPool()中分配(见TcpServer::createConnection)
+    Socket socket_;   // 封装了一个文件描述符以及对应的bind listen accep shutdownWritet等操作
+    Channel channel_; // 连接一个EventLoop和一个打开的文件描述符的桥梁 能够注册/删除文件描述符到loop 和设置相关的回调函数
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
 
@@ -134,8 +204,12 @@ private:
     HighWaterMarkCallback highwatermarkCallback_;//高水位标回调函数
     CloseCallback closeCallback_;
     size_t highWaterMark_;
+    size_t zeroCopyThreshold_;
+    uint64_t zeroCopyCompletions_;
+    uint64_t zeroCopyCopied_;
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    OutputQueue outputQueue_; // 应用层输出缓冲区 由若干段数据组成 用writev发送
+    RestartableTimer idleTimer_; // 空闲超时 timeout为0时不启动
     std::any context_;
 };
 
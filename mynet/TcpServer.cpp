@@ -3,24 +3,56 @@
 #include "mynet/EventLoopThreadPool.h"
 #include "mynet/SocketsOps.h"
 #include "base/Logger.h"
+#include "base/ConcurrentFreeList.h"
 #include "mynet/Acceptor.h"
 
-TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg, Option op) : loop_(loop), ipPort_(listenAddr.toIpPort()), name_(nameArg), acceptor_(new Acceptor(loop, listenAddr, op == kReusePort)), threadPool_(new EventLoopThreadPool(loop, name_)),
-                                                                                                              connectionCallback_(defaultConnectionCallback), messageCallback_(defaultMessageCallback), nextConnId_(1)
+#include <future>
+#include <string_view>
+
+TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg, Option op) : loop_(loop), listenAddr_(listenAddr), ipPort_(listenAddr.toIpPort()), name_(nameArg), acceptorPerLoop_(op == kReusePortPerLoop),
+                                                                                                              acceptor_(acceptorPerLoop_ ? nullptr : new Acceptor(loop, listenAddr, op == kReusePort)), threadPool_(new EventLoopThreadPool(loop, name_)),
+                                                                                                              connectionCallback_(defaultConnectionCallback), messageCallback_(defaultMessageCallback), nextConnId_(1), connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_ + "#")), completionMode_(false), edgeTriggered_(false), zeroCopyThreshold_(0), idleTimeout_(0.0), idleSlack_(0.0)
 {
-    acceptor_->setNewConnectionCallback_(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (acceptor_)
+    {
+        acceptor_->setNewConnectionCallback_(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+        acceptor_->setAcceptBatchCallback(std::bind(&TcpServer::dispatchPendingConnections, this));
+    }
 }
 
 TcpServer::~TcpServer()
 {
     loop_->assertInLoopThread();
     LOG_TRACE << "TcpServer::~TcpServer[" << name_ << "] destructing";
-    for (auto &item : connections_)
+    std::map<EventLoop *, Acceptor *> acceptors; // 只有kReusePortPerLoop时有
+    for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        EventLoop *ioLoop = acceptor->getLoop();
+        acceptors[ioLoop] = acceptor.release();
+    }
+    // (各loop的)Acceptor和连接都在各自的IO线程中销毁 等全部完成再返回: 之后不会再有回调用到server
+    // (IO线程可能随后就退出 不能把销毁留在任务队列里) main loop转交的连接还在任务队列里的 排在这个任务之前
+    std::vector<std::future<void>> stopped;
+    for (auto &item : loopConnections_)
+    {
+        Acceptor *acceptor = acceptors[item.first];
+        std::shared_ptr<LoopConnections> conns = item.second;
+        auto done = std::make_shared<std::promise<void>>();
+        stopped.push_back(done->get_future());
+        item.first->runInLoop([acceptor, conns, done]()
+                              {
+                                  delete acceptor;
+                                  for (auto &entry : *conns)
+                                  {
+                                      entry.second->connectDestroyed();
+                                  }
+                                  conns->clear();
+                                  done->set_value();
+                              });
+    }
+    for (std::future<void> &f : stopped)
     {
-        TcpConnectionPtr conn(item.second); // 生成conn对象 引用计数+1
-        item.second.reset();                // 释放原conn对象 引用计数减一
-        conn->getLoop()->runInLoop(
-            bind(&TcpConnection::connectDestroyed, conn));
+        f.wait();
     }
 }
 
@@ -32,54 +64,145 @@ void TcpServer::setThreadNum(int numThreads)
 
 void TcpServer::start()
 {
-    if (started_ == 0)
+    if (started_.exchange(1) == 0)
     { // 确保只启动一次
         threadPool_->start(threadInitCallback_);
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            loopConnections_[ioLoop] = std::make_shared<LoopConnections>();
+        }
+        if (acceptorPerLoop_)
+        { // 每个loop一个监听socket 都绑定到同一个地址 在各自的线程中listen
+          // 等所有socket都listen了再返回 与单个Acceptor时一样 start()返回后就可以connect
+            std::vector<std::future<void>> listening;
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                acceptor->setNewConnectionCallback_(std::bind(&TcpServer::newConnectionInIoLoop, this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+                loopAcceptors_.emplace_back(acceptor);
+                auto done = std::make_shared<std::promise<void>>();
+                listening.push_back(done->get_future());
+                ioLoop->runInLoop([acceptor, done]()
+                                  {
+                                      acceptor->listen();
+                                      done->set_value();
+                                  });
+            }
+            for (std::future<void> &f : listening)
+            {
+                f.wait();
+            }
+            return;
+        }
         assert(!acceptor_->listening());
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
 }
 
+namespace
+{
+// 只取对端的IP 不含端口: 同一个客户端的多个连接得到相同的值
+size_t peerHashOf(const InetAddress &peerAddr)
+{
+    if (peerAddr.family() == AF_INET)
+    {
+        return std::hash<uint32_t>()(peerAddr.ipv4NetEndian());
+    }
+    const sockaddr_in6 *addr6 = reinterpret_cast<const sockaddr_in6 *>(peerAddr.getSockAddr());
+    const char *bytes = reinterpret_cast<const char *>(&addr6->sin6_addr);
+    return std::hash<std::string_view>()(std::string_view(bytes, sizeof addr6->sin6_addr));
+}
+}
+
 // 新客户端连接到来时 需要接收一个sockfd是客户端与服务器通信的fd 以及对端地址
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
     loop_->assertInLoopThread();
-    EventLoop *ioLoop = threadPool_->getNextLoop();
-    char buf[64];
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_; //
-    std::string connName = name_ + buf;
+    size_t peerHash = threadPool_->dispatchPolicy() == EventLoopThreadPool::kConsistentHash ? peerHashOf(peerAddr) : 0;
+    EventLoop *ioLoop = threadPool_->getLoopForConnection(peerHash);
+    TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+    pendingConnections_[ioLoop].push_back(std::move(conn)); // 等这一批accept完再投递
+}
+
+void TcpServer::dispatchPendingConnections()
+{
+    loop_->assertInLoopThread();
+    for (auto &item : pendingConnections_)
+    {
+        if (item.second.empty())
+        {
+            continue;
+        }
+        std::shared_ptr<LoopConnections> conns = loopConnections_[item.first];
+        item.first->runInLoop([conns, batch = std::move(item.second)]()
+                              {
+                                  for (const TcpConnectionPtr &conn : batch)
+                                  {
+                                      conns->emplace(conn->id(), conn);
+                                      conn->connectEstablished();
+                                  }
+                              });
+        item.second.clear(); // 移动之后的vector状态未指定 清空后复用
+    }
+}
+
+void TcpServer::newConnectionInIoLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    ioLoop->assertInLoopThread();
+    TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+    loopConnections_.at(ioLoop)->emplace(conn->id(), conn);
+    conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    uint64_t id = nextConnId_.fetch_add(1, std::memory_order_relaxed);
     LOG_INFO << "TcpServer::newConnection [" << name_
-             << "] - new connection [" << connName
+             << "] - new connection [" << *connNamePrefix_ << id
              << "] from " << peerAddr.toIpPort();
     InetAddress localAddr(sockets::getLocalAddr(sockfd));
-    //TcpConnectionPtr是智能指针 离开作用域会销毁
-    TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                            connName,
-                                            sockfd,
-                                            localAddr,
-                                            peerAddr));
-    connections_[connName] = conn;
+    // 连接对象(内嵌Socket和Channel)与shared_ptr的控制块一次分配 从当前线程所在loop(main loop或者kReusePortPerLoop时的ioLoop)的池中取
+    // 最后一个引用释放时(通常是connectDestroyed之后)块回到这个池
+    EventLoop *allocLoop = acceptorPerLoop_ ? ioLoop : loop_;
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(ConcurrentFreeListAllocator<TcpConnection>(allocLoop->connectionPool()),
+                                                                ioLoop,
+                                                                id,
+                                                                connNamePrefix_,
+                                                                sockfd,
+                                                                localAddr,
+                                                                peerAddr);
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, placeholders::_1));
-    
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setCompletionMode(completionMode_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setZeroCopyThreshold(zeroCopyThreshold_);
+    conn->setIdleTimeout(idleTimeout_, idleSlack_);
+    conn->setCloseCallback([this](const TcpConnectionPtr &c) { removeConnectionInIoLoop(c); }); // 只捕获this 放得进std::function内部 不分配
+    return conn;
 }
 
-// 非线程安全
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+void TcpServer::removeConnectionInIoLoop(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    EventLoop *ioLoop = conn->getLoop();
+    ioLoop->assertInLoopThread();
+    LOG_INFO << "TcpServer::removeConnectionInIoLoop[" << name_ << "] - connection " << *connNamePrefix_ << conn->id();
+    size_t n = loopConnections_.at(ioLoop)->erase(conn->id());
+    assert(n == 1); (void)n;
+    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn)); // 与原来一样 等handleClose返回之后再销毁
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+void TcpServer::broadcast(const SharedSlice &message)
 {
-    loop_->assertInLoopThread();
-    LOG_INFO << "TcpServer::removeConnectionInLoop[" << name_ << "] - connection " << conn->name();
-    size_t n = connections_.erase(conn->name());
-    assert(n == 1);
-    EventLoop* ioloop = conn->getLoop();
-    ioloop->queueInLoop(bind(&TcpConnection::connectDestroyed,conn));
+    for (auto &item : loopConnections_)
+    { // 一个loop一个任务 任务里只复制SharedSlice(增加一次引用) 每个连接排队时再各自增加一次引用
+        std::shared_ptr<LoopConnections> conns = item.second;
+        item.first->runInLoop([conns, message]()
+                              {
+                                  for (auto &entry : *conns)
+                                  {
+                                      entry.second->send(message);
+                                  }
+                              });
+    }
 }
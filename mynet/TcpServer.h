@@ -2,12 +2,15 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include "mynet/TcpConnection.h"
+#include "mynet/EventLoopThreadPool.h"
 #include "base/Noncopyable.h"
 
 class Acceptor;
 class EventLoop;
-class EventLoopThreadPool;
 
 class TcpServer : noncopyable
 {
@@ -17,7 +20,10 @@ public:
     enum Option
     {
         kNoReusePort,
-        kReusePort
+        kReusePort,
+        // 每个IO loop各有一个SO_REUSEPORT的Acceptor 由内核把新连接分给各个监听socket
+        // accept、创建TcpConnection和之后的读写都在同一个loop线程中 不再经过main loop转交
+        kReusePortPerLoop
     };
     TcpServer(EventLoop *loop,
               const InetAddress &listenAddr,
@@ -26,13 +32,19 @@ public:
 
     ~TcpServer();
     //设置处理输入的线程数
-    //新的连接永远在loop线程中accept
+    //新的连接在loop线程中accept(kReusePortPerLoop时在各个IO线程中各自accept)
     //@param numThreads
     // - 0 意味着所有的I/O都在loop线程中进行
     // - 1 表示着创建另一个新线程去处理I/O操作
     // - N 表示创建一个线程池大小为N,新连接到来分派到哪个线程池依据轮询算法
     void setThreadNum(int numThreads);
     void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    //IO线程与main loop线程绑核/NUMA节点 见EventLoopThreadPool 必须在start()之前调用
+    void setThreadPlacements(const std::vector<CpuPlacement> &placements) { threadPool_->setThreadPlacements(placements); }
+    void setBaseLoopPlacement(const CpuPlacement &placement) { threadPool_->setBaseLoopPlacement(placement); }
+    //新连接分给哪个IO线程 默认轮询 必须在start()之前调用
+    //kReusePortPerLoop时由内核分配 这个设置不起作用
+    void setDispatchPolicy(EventLoopThreadPool::DispatchPolicy policy) { threadPool_->setDispatchPolicy(policy); }
     //必须在调用start()函数之后调用
     std::shared_ptr<EventLoopThreadPool> threadPool()
     {
@@ -57,30 +69,65 @@ public:
     void setWriteCompleteCallback(const WriteCompleteCallback& cb){
         writeCompleteCallback_ = cb;
     }
+    //新连接使用io_uring完成模式读写(需要MUDUO_USE_IOURING) 必须在start()之前调用
+    void setCompletionMode(bool on){
+        completionMode_ = on;
+    }
+    //新连接以边沿触发方式注册(只对epoll生效) 必须在start()之前调用
+    void setEdgeTriggered(bool on){
+        edgeTriggered_ = on;
+    }
+    //把同一条消息发给所有连接 线程安全 必须在start()之后调用
+    //每个IO loop只投递一个任务 由它给本loop上的连接逐个send 所有连接共享message的同一份内存
+    void broadcast(const SharedSlice &message);
+    //新连接对不小于threshold字节的移交所有权的数据使用MSG_ZEROCOPY发送 0表示关闭 必须在start()之前调用
+    void setZeroCopyThreshold(size_t threshold){
+        zeroCopyThreshold_ = threshold;
+    }
+    //新连接连续seconds秒没有收到数据就强制关闭 0表示不限 允许晚slack秒关闭 必须在start()之前调用
+    void setIdleTimeout(double seconds, double slack = 0.0){
+        idleTimeout_ = seconds;
+        idleSlack_ = slack;
+    }
     
 
 
 private:
     // 非线程安全的 但是in loop
     void newConnection(int sockfd, const InetAddress &peerAddr);
-    // 线程安全
-    void removeConnection(const TcpConnectionPtr &conn);
-    // 非线程安全 但是in loop
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    // Acceptor一次可读事件accept完之后调用: 每个IO loop只投递一个任务 建立这一批分给它的连接
+    void dispatchPendingConnections();
+    // kReusePortPerLoop: 在ioLoop线程中accept到的连接 直接在本线程建立
+    void newConnectionInIoLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 连接关闭时在它所在的loop线程中移除 不经过main loop
+    void removeConnectionInIoLoop(const TcpConnectionPtr &conn);
 
-    using ConnectionMap = std::map<string, TcpConnectionPtr>;
+    // 某个IO loop上属于本server的连接 按TcpConnection::id()索引 只在那个loop线程中增删和遍历
+    using LoopConnections = std::unordered_map<uint64_t, TcpConnectionPtr>;
+    using LoopConnectionsMap = std::map<EventLoop *, std::shared_ptr<LoopConnections>>;
 
     EventLoop *loop_; // the acceptor loop 也就是main loop
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
-    std::unique_ptr<Acceptor> acceptor_;
+    const bool acceptorPerLoop_; // kReusePortPerLoop
+    std::unique_ptr<Acceptor> acceptor_; // kReusePortPerLoop时为空
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_; // kReusePortPerLoop: 每个IO loop一个 start()时创建 在各自的loop线程中析构
     std::shared_ptr<EventLoopThreadPool> threadPool_;
     ConnectionCallback connectionCallback_;
     MessageCallback messageCallback_;
     WriteCompleteCallback writeCompleteCallback_;
     ThreadInitCallback threadInitCallback_;
     std::atomic<int32_t> started_ = 0;
-    int nextConnId_;
-    ConnectionMap connections_;
+    std::atomic<uint64_t> nextConnId_; // kReusePortPerLoop时多个IO线程同时分配
+    const std::shared_ptr<const std::string> connNamePrefix_; // "name-ip:port#" 连接的名字是它后接id 所有连接共用
+    bool completionMode_;
+    bool edgeTriggered_;
+    size_t zeroCopyThreshold_;
+    double idleTimeout_;
+    double idleSlack_;
+    std::map<EventLoop *, std::vector<TcpConnectionPtr>> pendingConnections_; // 本批accept到 还没投递的连接 只在main loop中使用
+    LoopConnectionsMap loopConnections_; // start()时为每个IO loop建好 之后不再改变 所以broadcast可以跨线程读
 };
 
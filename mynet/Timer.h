@@ -1,47 +1,110 @@
 #pragma once
 #include "mynet/Callbacks.h"
-#include "base/Timestamp.h"
+#include "base/MonoTimestamp.h"
 #include "base/Noncopyable.h"
 #include <atomic>
 
-class Timer :noncopyable //定时器高层次的封装类 封装了 定时器任务的各项接口
+// 时间轮槽中侵入式双向循环链表的节点 不在任何槽中时prev/next为nullptr 挂入/摘除都是O(1)且不分配内存
+struct TimerHook
+{
+    TimerHook *prev = nullptr;
+    TimerHook *next = nullptr;
+    bool linked() const { return next != nullptr; }
+};
+
+class Timer :noncopyable, public TimerHook //定时器高层次的封装类 封装了 定时器任务的各项接口
 {
 private:
-    const TimerCallback callback_;
-    Timestamp expiration_; //超时时刻
-    const double interval_;  //超时事件间隔 如果单次定时器这里为0
-    const bool repeat_;  
-    const int64_t sequence_; //定时器序号
-    static std::atomic<int64_t> s_numCreated_; //当前已创造的定时器数量
-    
+    TimerCallback callback_;
+    MonoTimestamp expiration_; //超时时刻 也是定时器队列排序用的时刻
+    MonoTimestamp extended_; //extend()推迟后的超时时刻 无效表示没有推迟; 不立即重新排序 按原来的时刻到期时再放到新的位置
+    double interval_;  //超时事件间隔 如果单次定时器这里为0
+    int64_t slack_; //允许推迟触发的微秒数 在[expiration_, expiration_ + slack_]内触发都可以 定时器队列借此合并唤醒
+    bool repeat_;
+    bool canceled_; //已经到期 正在等待回调时被取消 处理完之后不再重启
+    int64_t sequence_; //代数 Timer对象由TimerPool复用 每回收一次加一 与TimerId中的比较就知道是不是同一个定时器
+    static std::atomic<int64_t> s_numCreated_; //当前已创造的定时器对象数量
+
 public:
-    Timer(TimerCallback cb, Timestamp when, double interval):callback_(std::move(cb)),
-    expiration_(when),
-    interval_(interval),
-    repeat_(interval_ > 0.0),
-    sequence_(++s_numCreated_)
-    {}
+    Timer():expiration_(),
+    interval_(0.0),
+    slack_(0),
+    repeat_(false),
+    canceled_(false),
+    sequence_(0)
+    {
+        ++s_numCreated_;
+    }
+    Timer(TimerCallback cb, MonoTimestamp when, double interval, double slack = 0.0):Timer()
+    {
+        reset(std::move(cb), when, interval, slack);
+    }
     ~Timer() = default;
 
+    // TimerPool复用这个对象: 换上新的回调和到期时间 代数不变(回收时已经加过)
+    void reset(TimerCallback cb, MonoTimestamp when, double interval, double slack = 0.0){
+        callback_ = std::move(cb);
+        expiration_ = when;
+        interval_ = interval;
+        slack_ = slack > 0.0 ? static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond) : 0;
+        repeat_ = interval > 0.0;
+        canceled_ = false;
+        extended_ = MonoTimestamp::invalid();
+    }
+    // TimerPool回收: 释放回调持有的资源 之前发出的TimerId从此不再匹配
+    void retire(){
+        callback_ = nullptr;
+        ++sequence_;
+    }
+
     void run(){
         callback_();
     }
-    Timestamp expiration() const{
+    MonoTimestamp expiration() const{
         return expiration_;
     }
+    int64_t slack() const{
+        return slack_;
+    }
+    // 最晚的触发时刻 timerfd按所有定时器中最早的deadline设置
+    MonoTimestamp deadline() const{
+        return MonoTimestamp(expiration_.microSeconds() + slack_);
+    }
     bool repeat() const{
         return repeat_;
     }
     int64_t sequence() const{
         return sequence_;
     }
+    void cancel(){
+        canceled_ = true;
+    }
+    bool canceled() const{
+        return canceled_;
+    }
+
+    void restart(MonoTimestamp now);
+
+    // 推迟到when 只改一个字段 定时器队列不用动
+    void extend(MonoTimestamp when){
+        extended_ = when;
+    }
+    // 提前到when 调用者负责按新的时刻重新排序
+    void reschedule(MonoTimestamp when){
+        expiration_ = when;
+        extended_ = MonoTimestamp::invalid();
+    }
+    // 按原来的时刻到期时调用: 推迟过且新的时刻还没到 返回true 此时expiration()已是新的时刻 应该重新放置而不是运行
+    bool postponed(MonoTimestamp now){
+        if (!extended_.valid()){
+            return false;
+        }
+        expiration_ = extended_;
+        extended_ = MonoTimestamp::invalid();
+        return now < expiration_;
+    }
 
-    void restart(Timestamp now);
-    
     static int64_t numCreate(){
         return s_numCreated_.load();
     }
 };
-
-
-
@@ -0,0 +1,15 @@
+#include "mynet/TimerPool.h"
+
+const int TimerPool::kChunkSize;
+
+void TimerPool::grow()
+{
+    std::unique_ptr<Timer[]> chunk(new Timer[kChunkSize]);
+    for (int i = kChunkSize - 1; i >= 0; --i)
+    { // 倒着挂 取出来的顺序与内存顺序一致
+        chunk[i].next = freeList_;
+        freeList_ = &chunk[i];
+    }
+    freeCount_ += kChunkSize;
+    chunks_.push_back(std::move(chunk));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "mynet/Timer.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 每个TimerQueue(也就是每个loop)一个的Timer对象池
+ * loop线程中添加定时器时从空闲链表取一个Timer 没有空闲时一次分配kChunkSize个; 到期或取消后回收进空闲链表
+ * 其他线程添加定时器时不能碰空闲链表 单独new一个 进入loop线程后由池接管(adopt) 回收后同样复用
+ * Timer对象的内存直到池析构才释放 回收时代数加一: 旧的TimerId里的指针始终指向有效的Timer 比较代数就能判断是否过期
+ * 空闲链表借用TimerHook::next串起来 不额外占用内存; 只能在loop线程中使用
+ */
+class TimerPool : noncopyable
+{
+public:
+    static const int kChunkSize = 64;
+
+    TimerPool() : freeList_(nullptr), freeCount_(0) {}
+
+    Timer *acquire(TimerCallback cb, MonoTimestamp when, double interval, double slack)
+    {
+        Timer *timer = freeList_;
+        if (!timer)
+        {
+            grow();
+            timer = freeList_;
+        }
+        freeList_ = static_cast<Timer *>(timer->next);
+        timer->next = nullptr;
+        --freeCount_;
+        timer->reset(std::move(cb), when, interval, slack);
+        return timer;
+    }
+
+    // 其他线程创建的Timer 由池负责释放
+    void adopt(Timer *timer) { strays_.emplace_back(timer); }
+
+    void release(Timer *timer)
+    {
+        timer->retire();
+        timer->prev = nullptr;
+        timer->next = freeList_;
+        freeList_ = timer;
+        ++freeCount_;
+    }
+
+    size_t freeCount() const { return freeCount_; }
+    size_t capacity() const { return chunks_.size() * kChunkSize + strays_.size(); }
+
+private:
+    void grow();
+
+    std::vector<std::unique_ptr<Timer[]>> chunks_;
+    std::vector<std::unique_ptr<Timer>> strays_;
+    Timer *freeList_;
+    size_t freeCount_;
+};
@@ -3,57 +3,64 @@
  * 高效的定时器队列
  *
  */
-#include <vector>
-#include <set>
 #include "base/Noncopyable.h"
-// #include <base/TImestamp.h>
+#include "base/MonoTimestamp.h"
 #include "mynet/Callbacks.h"
 #include "mynet/Channel.h"
-#include "atomic"
+#include "mynet/TimerId.h"
+#include "mynet/TimerPool.h"
 class EventLoop;
 class Timer;
-class TimerId;
-class Timestamp;
 
 /**
- * 自定义的类若只给出了声明，没有给出定义。不完整类型必须通过某种方式补充完整，才能使用它们进行实例化，
- * 否则只能用于定义指针或引用，因为此时实例化的是指针或引用本身，不是base或test对象。
-*/
-
-//定时器管理类
+ * 定时器管理类(抽象) 与Poller一样由EventLoop持有 通过环境变量选择实现
+ * 这里负责timerfd 以及可以跨线程调用的addTimer/cancel 定时器怎样组织由子类决定:
+ * SetTimerQueue 两个std::set按到期时间排序 插入/取消都是O(log n)
+ * TimingWheel   分层时间轮 插入/取消O(1) 到期时整槽处理 精度1ms
+ */
 class TimerQueue : noncopyable
 {
-private:
-//改进点是 这里Timer *用智能指针代替 unique_ptr
-    using Entry = std::pair<Timestamp, Timer *>; 
-    using TimerList = std::set<Entry>; //用set是因为按时间排序 
-    using ActiveTimer = std::pair<Timer *, int64_t>;
-    using ActiveTimerSet = std::set<ActiveTimer>;
+public:
+    explicit TimerQueue(EventLoop *loop);
+    virtual ~TimerQueue();
 
-    void addTimerInLoop(Timer *timer);   //只能在所属的线程中调用 因而不必加锁 服务器性能杀手是锁竞争 因而尽可能少用锁
-    void cancelInLoop(TimerId timerId); //只能在所属的线程中调用 因而不必加锁 服务器性能杀手是锁竞争 因而尽可能少用锁
+    //添加一个定时器 一定是线程安全的，可以跨线程调用 通常情况下被其他线程调用
+    //slack秒: 允许在[when, when + slack]内的任意时刻触发 时刻相近的定时器可以合并成一次timerfd唤醒
+    TimerId addTimer(TimerCallback cb,MonoTimestamp when, double interval, double slack = 0.0);
+    void cancel(TimerId timerid); //取消一个定时器 一定是线程安全的，可以跨线程调用 通常情况下被其他线程调用
+    // 修改定时器的超时时刻 可以跨线程调用; 在loop线程中直接完成:
+    // 推迟(空闲超时这类频繁重置的用法)只记下新的时刻 按原来的时刻到期时才重新排序 提前则立即重新排序
+    void extend(TimerId timerId, MonoTimestamp when);
 
-    void handleRead();
-    // move out all expired timers
-    std::vector<Entry> getExpired(Timestamp now); //返回超时的定时器列表
-    void reset(const std::vector<Entry> &expired, Timestamp now);//对超时的定时器重置 （如果是重复的定时器）
+    // MUDUO_USE_TIMING_WHEEL -> TimingWheel 默认为SetTimerQueue
+    static TimerQueue *newDefaultTimerQueue(EventLoop *loop);
+
+protected:
+    //只能在所属的线程中调用 因而不必加锁 服务器性能杀手是锁竞争 因而尽可能少用锁
+    virtual void addTimerInLoop(Timer *timer) = 0;
+    virtual void cancelInLoop(TimerId timerId) = 0;
+    // 定时器还在队列中时把它提前到when(已经到期的忽略)
+    virtual void rescheduleInLoop(Timer *timer, MonoTimestamp when) = 0;
+    // timerfd到期: 运行now之前到期的所有定时器 重启重复的定时器 并重新设置timerfd
+    virtual void handleExpired(MonoTimestamp now) = 0;
+
+    // timerfd需要在deadline之前(含)到期: 已经设置的时刻不晚于deadline时什么都不做 省掉一次timerfd_settime
+    // timerfd到期后(handleExpired之前)视为没有设置 子类处理完到期的定时器后用剩下的最早deadline重新设置
+    void armTimerfd(MonoTimestamp deadline);
 
-    bool insert(Timer *timer);
+    // TimerId只把TimerQueue声明为友元 子类通过这里访问
+    static Timer *timerOf(TimerId timerId) { return timerId.timer_; }
+    static int64_t sequenceOf(TimerId timerId) { return timerId.sequence_; }
 
     EventLoop *loop_;
-    const int timerfd_;
-    Channel timerfdChannel_;
-    TimerList timers_;//std::set<Entry>; 按到期时间排序
-    ActiveTimerSet activeTimers_;//ActiveTimerSet ; ActiveTimer = std::pair<Timer *, int64_t>; 按定时器地址排序
-    // for cancel
-   
-    std::atomic<bool> callingExpiredTimers_; // 过期定时器
-    ActiveTimerSet cancelingTimers_; 
+    TimerPool timerPool_; // 本loop所有的Timer对象都由它持有 子类到期/取消后release回池中 不再delete
 
-public:
-    explicit TimerQueue(EventLoop *loop);
-    ~TimerQueue();
+private:
+    void handleRead();
+    void resetTimerfd(MonoTimestamp expiration); // 设置timerfd的下一次超时时刻
+    void extendInLoop(TimerId timerId, MonoTimestamp when);
 
-    TimerId addTimer(TimerCallback cb,Timestamp when, double interval); //添加一个定时器 一定是线程安全的，可以跨线程调用 通常情况下被其他线程调用
-    void cancel(TimerId timerid); //取消一个定时器 一定是线程安全的，可以跨线程调用 通常情况下被其他线程调用
+    const int timerfd_;
+    Channel timerfdChannel_;
+    MonoTimestamp armed_; // timerfd当前设置的时刻 无效表示没有设置
 };
@@ -0,0 +1,98 @@
+#include "mynet/ZeroCopyGraveyard.h"
+#include "mynet/EventLoop.h"
+#include "mynet/OutputQueue.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+constexpr double ZeroCopyGraveyard::kCheckInterval;
+constexpr double ZeroCopyGraveyard::kLingerSeconds;
+
+ZeroCopyGraveyard::ZeroCopyGraveyard(EventLoop *loop)
+    : loop_(loop),
+      timer_(loop, kCheckInterval)
+{
+    timer_.setSlack(kCheckInterval / 2); // 晚一点释放没有关系 和附近的定时器一起唤醒
+    timer_.setCallback([this]() { check(); });
+}
+
+ZeroCopyGraveyard::~ZeroCopyGraveyard()
+{
+    for (Grave &grave : graves_)
+    {
+        if (grave.fd >= 0)
+        {
+            ::close(grave.fd);
+        }
+    }
+}
+
+void ZeroCopyGraveyard::adopt(int sockfd, std::unique_ptr<ZeroCopyPins> pins)
+{
+    loop_->assertInLoopThread();
+    ::shutdown(sockfd, SHUT_WR); // 对端已经重置时失败(ENOTCONN) 不影响
+    MonoTimestamp now = loop_->monoNow();
+    graves_.push_back(Grave{sockfd, std::move(pins), addTime(now, kLingerSeconds)});
+    if (reap(graves_.back(), now))
+    { // 通知已经在错误队列里了
+        graves_.pop_back();
+        return;
+    }
+    LOG_DEBUG << "ZeroCopyGraveyard::adopt fd " << sockfd << " " << graves_.back().pins->size() << " sends pending";
+    if (!timer_.armed())
+    {
+        timer_.restart(now);
+    }
+}
+
+bool ZeroCopyGraveyard::reap(Grave &grave, MonoTimestamp now)
+{
+    if (grave.fd < 0)
+    {
+        return true; // RST之后又过了一个检查周期 已经交给网卡的也发完了
+    }
+    ZeroCopyPins *pins = grave.pins.get();
+    sockets::readZeroCopyCompletions(grave.fd, [pins](uint32_t lo, uint32_t hi, bool)
+                                     { pins->complete(lo, hi); });
+    if (pins->empty())
+    {
+        ::close(grave.fd);
+        return true;
+    }
+    if (now >= grave.deadline)
+    { // 对端一直不确认 不能无限期占着内存: RST会清空发送队列 之后不再重传
+        LOG_WARN << "ZeroCopyGraveyard fd " << grave.fd << " still has " << pins->size()
+                 << " unacknowledged zero-copy sends after " << kLingerSeconds << "s, resetting";
+        linger lin;
+        lin.l_onoff = 1;
+        lin.l_linger = 0;
+        ::setsockopt(grave.fd, SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+        ::close(grave.fd);
+        grave.fd = -1;
+    }
+    return false;
+}
+
+void ZeroCopyGraveyard::check()
+{
+    loop_->assertInLoopThread();
+    MonoTimestamp now = loop_->monoNow();
+    for (size_t i = 0; i < graves_.size();)
+    {
+        if (reap(graves_[i], now))
+        { // 顺序无关 用最后一个填空位
+            std::swap(graves_[i], graves_.back());
+            graves_.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    if (!graves_.empty())
+    {
+        timer_.restart(now);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "base/MonoTimestamp.h"
+#include "mynet/RestartableTimer.h"
+
+#include <memory>
+#include <vector>
+
+class EventLoop;
+class ZeroCopyPins;
+
+/**
+ * 已经销毁的连接上还没等到完成通知的零拷贝内存 每个loop一个
+ * close()之后没有确认的数据还在socket的发送队列里 skb直接引用用户态的页面 重传时从这些页面读
+ * 内存提前释放被malloc或者别的连接复用 对端收到的就是错误的字节 所以连接销毁时把socket dup一份 连同内存交给这里
+ * 定时读错误队列 通知都到了才close并释放内存
+ * 超过kLingerSeconds还没有完成(对端一直不确认) 用SO_LINGER为0的close发RST丢弃发送队列 再过一个检查周期释放
+ * 只能在loop线程中使用
+ */
+class ZeroCopyGraveyard : noncopyable
+{
+public:
+    static constexpr double kCheckInterval = 0.1;
+    static constexpr double kLingerSeconds = 30.0;
+
+    explicit ZeroCopyGraveyard(EventLoop *loop);
+    ~ZeroCopyGraveyard(); // loop析构时还没有完成的直接释放
+
+    // sockfd归这里所有 先关闭写端: 连接原来的fd关闭时socket因为这份引用还开着 对端照样要收到FIN
+    void adopt(int sockfd, std::unique_ptr<ZeroCopyPins> pins);
+    size_t size() const { return graves_.size(); }
+
+private:
+    struct Grave
+    {
+        int fd; // RST之后为-1 等一个检查周期再释放内存
+        std::unique_ptr<ZeroCopyPins> pins;
+        MonoTimestamp deadline;
+    };
+
+    bool reap(Grave &grave, MonoTimestamp now); // 返回是否可以移除
+    void check();
+
+    EventLoop *loop_;
+    std::vector<Grave> graves_;
+    RestartableTimer timer_;
+};
@@ -1,13 +1,21 @@
 #include "mynet/Poller.h"
 #include "mynet/poller/EPollPoller.h"
 #include "mynet/poller/PollPoller.h"
+#include "mynet/poller/IoUringPoller.h"
+#include "base/Logger.h"
 #include <stdlib.h>
 
+// 通过环境变量选择I/O多路复用的实现 默认为epoll
+// MUDUO_USE_POLL    -> poll(2)
+// MUDUO_USE_IOURING -> io_uring 内核不支持时回退到epoll
 Poller* Poller::newDefualtPoller(EventLoop* loop){
+    if(::getenv("MUDUO_USE_POLL")){
+        return new PollPoller(loop);
+    }else if(::getenv("MUDUO_USE_IOURING")){
+        if(IoUringPoller::isSupported()){
+            return new IoUringPoller(loop);
+        }
+        LOG_WARN << "io_uring is not supported by this kernel, fall back to epoll";
+    }
     return new EPollPoller(loop);
-    // if(::getenv("MUDUO_USE_POLL")){
-    //     return new PollPoller(loop);
-    // }else{
-    //     return new EPollPoller(loop);
-    // }
 }
\ No newline at end of file
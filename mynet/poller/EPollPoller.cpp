@@ -35,7 +35,7 @@ EPollPoller::~EPollPoller()
 //EPollPoller的poll主要是调用epoll_wait()来获得活动事件
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels) // epoll 轮询 并获得
 {
-    LOG_TRACE << "fd total count " << channels_.size(); // channels_ 基类中的存放channel的map对象
+    LOG_TRACE << "fd total count " << channels_.size(); // channels_ 基类中的存放channel的登记表
     int numEvents = epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int savedErrno = errno;
     Timestamp now(std::chrono::system_clock::now());
@@ -76,22 +76,19 @@ void EPollPoller::updateChannel(Channel *channel) // 更新这次channel到 map
         int fd = channel->fd();
         if (index == kNew)
         {
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;
+            channels_.insert(fd, channel); // 内部断言fd之前没有登记
         }
         else
         { // index = kDeleted时 fd只是在epoll的关注中被移除了 并没有从channels_中remove
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
+            assert(channels_.find(fd) == channel);
         }
-        channels_[fd]->set_index(kAdded);
+        channel->set_index(kAdded);
         update(EPOLL_CTL_ADD, channel);
     }
     else // 更新一个存在的event 通过Epoll_CTL_MOD/DEL
     {
         int fd = channel->fd();
-        assert(channels_.find(fd) != channels_.end());
-        assert(channels_[fd] == channel);
+        assert(channels_.find(fd) == channel);
         assert(index == kAdded);
         if (channel->isNoEvent())
         { // channel的状态是删除
@@ -110,14 +107,13 @@ void EPollPoller::removeChannel(Channel *channel) // 从map中移除
     Poller::assertInLoopThread();
     int fd = channel->fd();
     LOG_TRACE << "fd = " << fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(channels_.find(fd) == channel);
     assert(channel->isNoEvent());
 
     int index = channel->index();
     assert(index == kAdded || index == kDeleted);
 
-    size_t n = channels_.erase(fd); // 从map中删除
+    size_t n = channels_.erase(fd); // 从登记表中删除
     assert(n == 1);
     if (index == kAdded) // 从epoll中删除
     {
@@ -133,10 +129,7 @@ void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
     {
         Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
 
-        int fd = channel->fd();
-        auto it = channels_.find(fd);
-        assert(it != channels_.end());
-        assert(it->second == channel);
+        assert(channels_.find(channel->fd()) == channel);
 
         channel->set_revents(events_[i].events); // 更新channel的revent事件 
         activeChannels->push_back(channel);
@@ -148,6 +141,10 @@ void EPollPoller::update(int operation, Channel *channel) // 将channel代表的
     epoll_event event;
     bzero(&event, sizeof event);
     event.events = channel->events(); // channel关注的事件
+    if (channel->edgeTriggered())
+    {
+        event.events |= EPOLLET;
+    }
     event.data.ptr = channel;
     int fd = channel->fd();
     LOG_TRACE << "epoll_ctl op = " << operationToString(operation) << " fd = " << fd << " event = {" << channel->eventsToString() << " }";
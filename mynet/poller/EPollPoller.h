@@ -13,6 +13,7 @@ public:
     Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
     void updateChannel(Channel *channel) override;
     void removeChannel(Channel *channel) override;
+    bool edgeTriggerSupported() const override { return true; }
 
 private:
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
@@ -0,0 +1,717 @@
+#include "IoUringPoller.h"
+#include "base/Logger.h"
+#include "mynet/Channel.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <signal.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+const unsigned IoUringPoller::kRingEntries;
+const unsigned IoUringPoller::kCompletionEntries;
+const unsigned IoUringPoller::kRecvBufferCount;
+const size_t IoUringPoller::kRecvBufferSize;
+const size_t IoUringPoller::kSendBlockSize;
+const uint16_t IoUringPoller::kBufferGroup;
+
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+// user_data的编码: 低32位是fd, 接着8位是操作类型, 高24位是poll请求的代数
+enum RingOp
+{
+    kOpPoll = 1,
+    kOpPollRemove = 2,
+    kOpRecv = 3,
+    kOpSend = 4,
+    kOpCancel = 5,
+};
+
+static uint64_t encodeUserData(int fd, RingOp op, uint32_t generation)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(fd)) |
+           (static_cast<uint64_t>(op) << 32) |
+           (static_cast<uint64_t>(generation & 0xFFFFFF) << 40);
+}
+
+static int decodeFd(uint64_t userData) { return static_cast<int>(userData & 0xFFFFFFFF); }
+static int decodeOp(uint64_t userData) { return static_cast<int>((userData >> 32) & 0xFF); }
+static uint32_t decodeGeneration(uint64_t userData) { return static_cast<uint32_t>(userData >> 40); }
+
+static int sysIoUringSetup(unsigned entries, io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static int sysIoUringRegister(int fd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+// 在ringfd上注册一个provided buffer ring; ring必须按页对齐
+static int registerBufferRing(int ringfd, io_uring_buf_ring *ring, unsigned entries, uint16_t group)
+{
+    io_uring_buf_reg reg;
+    bzero(&reg, sizeof reg);
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = entries;
+    reg.bgid = group;
+    return sysIoUringRegister(ringfd, IORING_REGISTER_PBUF_RING, &reg, 1);
+}
+
+bool IoUringPoller::isSupported()
+{
+    static const bool supported = []()
+    {
+        io_uring_params params;
+        bzero(&params, sizeof params);
+        int fd = sysIoUringSetup(4, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(fd);
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+bool IoUringPoller::isCompletionIoSupported()
+{
+    static const bool supported = []()
+    {
+        if (!isSupported())
+        {
+            return false;
+        }
+        io_uring_params params;
+        bzero(&params, sizeof params);
+        int fd = sysIoUringSetup(4, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        const size_t size = 4096;
+        void *ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        bool ok = ring != MAP_FAILED && registerBufferRing(fd, static_cast<io_uring_buf_ring *>(ring), 8, 0) == 0;
+        ::close(fd);
+        if (ring != MAP_FAILED)
+        {
+            ::munmap(ring, size);
+        }
+        return ok;
+    }();
+    return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop) : Poller(loop),
+                                                ringfd_(-1),
+                                                features_(0),
+                                                sqRing_(nullptr),
+                                                sqRingSize_(0),
+                                                sqes_(nullptr),
+                                                sqesSize_(0),
+                                                sqeTail_(0),
+                                                cqRing_(nullptr),
+                                                cqRingSize_(0),
+                                                nextGeneration_(0),
+                                                round_(0),
+                                                bufRing_(nullptr),
+                                                bufRingSize_(0),
+                                                recvBuffers_(nullptr),
+                                                bufRingTail_(0),
+                                                pendingIo_(0)
+{
+    setupRing();
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    // 关闭ring后内核是异步回收请求的: 未完成的poll会让已关闭的监听socket继续占用端口, 未完成的recv/send还可能写入下面要释放的缓冲区
+    // 所以先取消所有请求并等到它们都完成
+    drainRequests();
+    ::close(ringfd_);
+    for (auto &item : sendOps_)
+    {
+        delete[] item.second.block;
+    }
+    for (char *block : freeSendBlocks_)
+    {
+        delete[] block;
+    }
+    if (bufRing_)
+    {
+        ::munmap(bufRing_, bufRingSize_);
+        delete[] recvBuffers_;
+    }
+    ::munmap(sqes_, sqesSize_);
+    if (cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    ::munmap(sqRing_, sqRingSize_);
+}
+
+void IoUringPoller::drainRequests()
+{
+    for (int fd = 0; fd < static_cast<int>(channels_.capacity()); ++fd)
+    {
+        if (!channels_.contains(fd))
+        {
+            continue;
+        }
+        PollState &state = states_[fd];
+        if (state.armed)
+        {
+            cancelPoll(fd, &state);
+        }
+        if (state.recvInFlight)
+        {
+            cancelRequest(fd, encodeUserData(fd, kOpRecv, state.recvGeneration));
+        }
+        if (state.sendInFlight)
+        {
+            cancelRequest(fd, encodeUserData(fd, kOpSend, state.sendGeneration));
+        }
+    }
+    channels_.clear(); // 之后的完成事件全部当作过期事件处理
+    ChannelList ignored;
+    for (int retry = 0; retry < 100; ++retry)
+    {
+        submitAndWait(pendingIo_ > 0 ? 1 : 0, 10);
+        reapCompletions(&ignored);
+        if (pendingIo_ == 0)
+        {
+            return;
+        }
+    }
+    LOG_ERROR << "IoUringPoller::~IoUringPoller - " << pendingIo_ << " requests still in flight";
+}
+
+void IoUringPoller::setupRing()
+{
+    io_uring_params params;
+    bzero(&params, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE; // 大量fd同时就绪时 CQ环要比SQ环大
+    params.cq_entries = kCompletionEntries;
+    ringfd_ = sysIoUringSetup(kRingEntries, &params);
+    if (ringfd_ < 0)
+    {
+        LOG_SYSFATAL << "IoUringPoller::IoUringPoller";
+    }
+    features_ = params.features;
+    if (!(features_ & IORING_FEAT_EXT_ARG))
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - kernel lacks IORING_FEAT_EXT_ARG";
+    }
+
+    // SQ环和CQ环在内核5.4之后可以一次mmap映射
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        sqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        cqRingSize_ = sqRingSize_;
+    }
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_SYSFATAL << "IoUringPoller mmap sq ring";
+    }
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_SYSFATAL << "IoUringPoller mmap cq ring";
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+    {
+        LOG_SYSFATAL << "IoUringPoller mmap sqes";
+    }
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqeTail_ = *sqTail_;
+
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    LOG_DEBUG << "IoUringPoller ring fd = " << ringfd_ << " sq entries = " << params.sq_entries
+              << " cq entries = " << params.cq_entries;
+}
+
+// 取一个空闲的SQE; SQ环满了就先把已有的请求提交给内核
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    while (sqeTail_ - head >= sqEntries_)
+    {
+        if (submitAndWait(0, 0) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+        {
+            LOG_SYSFATAL << "IoUringPoller::getSqe";
+        }
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    }
+    unsigned idx = sqeTail_ & sqMask_;
+    io_uring_sqe *sqe = &sqes_[idx];
+    bzero(sqe, sizeof *sqe);
+    sqArray_[idx] = idx;
+    ++sqeTail_;
+    return sqe;
+}
+
+// 提交所有未提交的SQE; waitNr > 0 时最多等待timeoutMs毫秒(<0表示一直等)
+int IoUringPoller::submitAndWait(unsigned waitNr, int timeoutMs)
+{
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (toSubmit == 0 && waitNr == 0)
+    {
+        return 0;
+    }
+    unsigned flags = 0;
+    if (waitNr == 0)
+    {
+        return sysIoUringEnter(ringfd_, toSubmit, 0, flags, nullptr, _NSIG / 8);
+    }
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    bzero(&arg, sizeof arg);
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return sysIoUringEnter(ringfd_, toSubmit, waitNr, flags, &arg, sizeof arg);
+}
+
+unsigned IoUringPoller::completionsReady() const
+{
+    return __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) - *cqHead_;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_TRACE << "fd total count " << channels_.size();
+    ++round_;
+    recycleRecvBuffers(); // 上一轮的接收缓冲区已经被Channel处理完了
+    rearmFiredChannels(); // 上一轮触发过的fd 和本轮新的关注请求一起提交
+    int ret = submitAndWait(completionsReady() > 0 ? 0 : 1, timeoutMs);
+    int savedErrno = errno;
+    Timestamp now(std::chrono::system_clock::now());
+    if (ret < 0 && savedErrno != ETIME && savedErrno != EINTR && savedErrno != EBUSY)
+    { // ETIME表示等待超时 EBUSY表示CQ溢出 先把已有的完成事件取走即可
+        errno = savedErrno;
+        LOG_SYSERR << "IoUringPoller::poll()";
+    }
+
+    int numEvents = reapCompletions(activeChannels);
+    if (numEvents > 0)
+    {
+        LOG_TRACE << numEvents << " events happened";
+    }
+    else
+    {
+        LOG_TRACE << "nothing happened";
+    }
+    return now;
+}
+
+int IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    size_t numActive = activeChannels->size();
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe *cqe = &cqes_[head & cqMask_];
+        int op = decodeOp(cqe->user_data);
+        if (op == kOpRecv)
+        {
+            handleRecvCompletion(cqe, activeChannels);
+            continue;
+        }
+        else if (op == kOpSend)
+        {
+            handleSendCompletion(cqe, activeChannels);
+            continue;
+        }
+        else if (op != kOpPoll)
+        {
+            continue; // POLL_REMOVE和ASYNC_CANCEL自身的完成事件 不关心
+        }
+        int fd = decodeFd(cqe->user_data);
+        PollState *state = findState(fd);
+        if (!state || !state->armed || state->generation != decodeGeneration(cqe->user_data))
+        {
+            continue; // 已经被取消或者被移除的poll请求
+        }
+        state->armed = false;
+        Channel *channel = channels_.find(fd);
+        int revents = cqe->res;
+        if (cqe->res < 0)
+        {
+            LOG_ERROR << "IoUringPoller poll fd = " << fd << " failed: " << strerror_tl(-cqe->res);
+            revents = POLLERR;
+        }
+        fireChannel(state, channel, revents, activeChannels);
+        firedFds_.push_back(fd);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return static_cast<int>(activeChannels->size() - numActive);
+}
+
+// 同一个Channel在一轮中可能同时有poll/recv/send完成 合并成一次handleEvent
+void IoUringPoller::fireChannel(PollState *state, Channel *channel, int revents, ChannelList *activeChannels)
+{
+    if (state->round == round_)
+    {
+        channel->set_revents(channel->revents() | revents);
+    }
+    else
+    {
+        state->round = round_;
+        channel->set_revents(revents);
+        activeChannels->push_back(channel);
+    }
+}
+
+void IoUringPoller::handleRecvCompletion(const io_uring_cqe *cqe, ChannelList *activeChannels)
+{
+    --pendingIo_;
+    const char *data = nullptr;
+    if (cqe->flags & IORING_CQE_F_BUFFER)
+    { // 无论请求是否过期 内核选中的缓冲区都要归还
+        uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        consumedBuffers_.push_back(bid);
+        data = recvBuffers_ + bid * kRecvBufferSize;
+    }
+    int fd = decodeFd(cqe->user_data);
+    PollState *state = findState(fd);
+    if (!state || !state->recvInFlight || state->recvGeneration != decodeGeneration(cqe->user_data))
+    {
+        return;
+    }
+    state->recvInFlight = false;
+    Channel *channel = channels_.find(fd);
+    channel->set_recvResult(data, cqe->res);
+    fireChannel(state, channel, Channel::kRecvCompleteEvent, activeChannels);
+}
+
+void IoUringPoller::handleSendCompletion(const io_uring_cqe *cqe, ChannelList *activeChannels)
+{
+    --pendingIo_;
+    uint32_t generation = decodeGeneration(cqe->user_data);
+    SendOpMap::iterator op = sendOps_.find(generation);
+    assert(op != sendOps_.end());
+    int fd = op->second.fd;
+    PollState *state = findState(fd);
+    bool stale = !state || !state->sendInFlight || state->sendGeneration != generation;
+    if (!stale && cqe->res > 0 && static_cast<size_t>(cqe->res) < op->second.remaining)
+    { // 部分发送 续发剩余的部分
+        op->second.offset += cqe->res;
+        op->second.remaining -= cqe->res;
+        op->second.sent += cqe->res;
+        queueSend(generation, op->second);
+        return;
+    }
+    ssize_t result = cqe->res < 0 ? cqe->res : static_cast<ssize_t>(op->second.sent + cqe->res);
+    freeSendBlocks_.push_back(op->second.block);
+    sendOps_.erase(op);
+    if (stale)
+    {
+        return;
+    }
+    state->sendInFlight = false;
+    Channel *channel = channels_.find(fd);
+    channel->set_sendResult(result);
+    fireChannel(state, channel, Channel::kSendCompleteEvent, activeChannels);
+}
+
+uint32_t IoUringPoller::nextGeneration()
+{
+    nextGeneration_ = (nextGeneration_ + 1) & 0xFFFFFF;
+    return nextGeneration_;
+}
+
+void IoUringPoller::armPoll(int fd, uint32_t events, PollState *state)
+{
+    assert(!state->armed);
+    state->generation = nextGeneration();
+    state->armedEvents = events;
+    state->armed = true;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = encodeUserData(fd, kOpPoll, state->generation);
+    LOG_TRACE << "io_uring poll_add fd = " << fd << " events = " << events;
+}
+
+void IoUringPoller::cancelPoll(int fd, PollState *state)
+{
+    assert(state->armed);
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, kOpPoll, state->generation);
+    sqe->user_data = encodeUserData(fd, kOpPollRemove, 0);
+    state->armed = false; // 之后到达的同一代完成事件都会被忽略
+    LOG_TRACE << "io_uring poll_remove fd = " << fd;
+}
+
+void IoUringPoller::cancelRequest(int fd, uint64_t userData)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = encodeUserData(fd, kOpCancel, 0);
+    LOG_TRACE << "io_uring async_cancel fd = " << fd;
+}
+
+void IoUringPoller::rearmFiredChannels()
+{
+    for (int fd : firedFds_)
+    {
+        PollState *state = findState(fd);
+        if (!state || state->armed)
+        {
+            continue; // 已被移除 或者在事件处理中被updateChannel重新关注过了
+        }
+        Channel *channel = channels_.find(fd);
+        if (!channel->isNoEvent())
+        {
+            armPoll(fd, static_cast<uint32_t>(channel->events()), state);
+        }
+    }
+    firedFds_.clear();
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    Poller::assertInLoopThread();
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd << " events = " << channel->events() << " index = " << index;
+    if (index == kNew)
+    {
+        addChannel(channel);
+    }
+    else
+    {
+        assert(channels_.find(fd) == channel);
+    }
+
+    PollState &state = states_[fd];
+    const uint32_t events = static_cast<uint32_t>(channel->events());
+    if (state.armed && state.armedEvents != events)
+    { // 关注的事件变了 撤销旧的poll请求
+        cancelPoll(fd, &state);
+    }
+    if (!state.armed && !channel->isNoEvent())
+    {
+        armPoll(fd, events, &state);
+    }
+    channel->set_index(channel->isNoEvent() ? kDeleted : kAdded);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    Poller::assertInLoopThread();
+    int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd;
+    assert(channels_.find(fd) == channel);
+    assert(channel->isNoEvent());
+    int index = channel->index();
+    assert(index == kAdded || index == kDeleted);
+
+    PollState &state = states_[fd];
+    if (state.armed)
+    {
+        cancelPoll(fd, &state);
+    }
+    // 未完成的recv/send会一直持有socket 必须显式取消; 它们的完成事件随后因找不到状态而被忽略
+    if (state.recvInFlight)
+    {
+        cancelRequest(fd, encodeUserData(fd, kOpRecv, state.recvGeneration));
+    }
+    if (state.sendInFlight)
+    {
+        cancelRequest(fd, encodeUserData(fd, kOpSend, state.sendGeneration));
+    }
+    size_t n = channels_.erase(fd);
+    assert(n == 1);
+    channel->set_index(kNew);
+}
+
+bool IoUringPoller::completionIoSupported() const
+{
+    return isCompletionIoSupported();
+}
+
+// 完成模式的Channel不需要关注任何事件 但要登记在channels_中以便完成事件找到它
+IoUringPoller::PollState &IoUringPoller::registerChannel(Channel *channel)
+{
+    Poller::assertInLoopThread();
+    const int fd = channel->fd();
+    if (channel->index() == kNew)
+    {
+        addChannel(channel);
+        channel->set_index(kDeleted);
+    }
+    assert(channels_.find(fd) == channel);
+    return states_[fd];
+}
+
+// 登记一个新的Channel 并重置这个fd上一任主人留下的状态
+void IoUringPoller::addChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    channels_.insert(fd, channel);
+    if (states_.size() < channels_.capacity())
+    {
+        states_.resize(channels_.capacity());
+    }
+    states_[fd] = PollState();
+}
+
+// 只有登记过的fd的状态才有效
+IoUringPoller::PollState *IoUringPoller::findState(int fd)
+{
+    return channels_.contains(fd) ? &states_[fd] : nullptr;
+}
+
+void IoUringPoller::submitRecv(Channel *channel)
+{
+    if (!bufRing_)
+    {
+        setupBufferRing();
+    }
+    PollState &state = registerChannel(channel);
+    assert(!state.recvInFlight);
+    state.recvGeneration = nextGeneration();
+    state.recvInFlight = true;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = channel->fd();
+    sqe->flags = IOSQE_BUFFER_SELECT; // 由内核从缓冲区环中挑选接收缓冲区
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = encodeUserData(channel->fd(), kOpRecv, state.recvGeneration);
+    ++pendingIo_;
+    LOG_TRACE << "io_uring recv fd = " << channel->fd();
+}
+
+size_t IoUringPoller::submitSend(Channel *channel, const void *data, size_t len)
+{
+    assert(len > 0);
+    PollState &state = registerChannel(channel);
+    assert(!state.sendInFlight);
+    char *block = nullptr;
+    if (freeSendBlocks_.empty())
+    {
+        block = new char[kSendBlockSize];
+    }
+    else
+    {
+        block = freeSendBlocks_.back();
+        freeSendBlocks_.pop_back();
+    }
+    size_t n = std::min(len, kSendBlockSize);
+    memcpy(block, data, n);
+
+    SendOp op = {channel->fd(), block, 0, n, 0, n < len};
+    state.sendGeneration = nextGeneration();
+    state.sendInFlight = true;
+    sendOps_[state.sendGeneration] = op;
+    queueSend(state.sendGeneration, op);
+    return n;
+}
+
+void IoUringPoller::queueSend(uint32_t generation, const SendOp &op)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = op.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(op.block + op.offset);
+    sqe->len = static_cast<uint32_t>(op.remaining);
+    sqe->msg_flags = MSG_NOSIGNAL | (op.more ? MSG_MORE : 0);
+    sqe->user_data = encodeUserData(op.fd, kOpSend, generation);
+    ++pendingIo_;
+    LOG_TRACE << "io_uring send fd = " << op.fd << " len = " << op.remaining;
+}
+
+void IoUringPoller::setupBufferRing()
+{
+    bufRingSize_ = kRecvBufferCount * sizeof(io_uring_buf);
+    void *ring = ::mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        LOG_SYSFATAL << "IoUringPoller mmap buffer ring";
+    }
+    bufRing_ = static_cast<io_uring_buf_ring *>(ring);
+    if (registerBufferRing(ringfd_, bufRing_, kRecvBufferCount, kBufferGroup) < 0)
+    {
+        LOG_SYSFATAL << "IoUringPoller IORING_REGISTER_PBUF_RING";
+    }
+    recvBuffers_ = new char[kRecvBufferCount * kRecvBufferSize];
+    bufRingTail_ = 0;
+    for (unsigned i = 0; i < kRecvBufferCount; ++i)
+    {
+        consumedBuffers_.push_back(static_cast<uint16_t>(i));
+    }
+    recycleRecvBuffers();
+}
+
+void IoUringPoller::recycleRecvBuffers()
+{
+    if (consumedBuffers_.empty())
+    {
+        return;
+    }
+    const unsigned mask = kRecvBufferCount - 1;
+    // C++下__DECLARE_FLEX_ARRAY展开出的空结构体占1字节 bufs不在偏移0处 所以直接把环当作io_uring_buf数组
+    io_uring_buf *bufs = reinterpret_cast<io_uring_buf *>(bufRing_);
+    for (uint16_t bid : consumedBuffers_)
+    {
+        io_uring_buf *buf = &bufs[bufRingTail_ & mask];
+        buf->addr = reinterpret_cast<uint64_t>(recvBuffers_ + bid * kRecvBufferSize);
+        buf->len = static_cast<uint32_t>(kRecvBufferSize);
+        buf->bid = bid;
+        ++bufRingTail_;
+    }
+    __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+    consumedBuffers_.clear();
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "mynet/Poller.h"
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+/**
+ * 基于io_uring的Poller 用IORING_OP_POLL_ADD(单次触发)实现与EPollPoller相同的电平触发语义
+ * 关注/修改/取消关注不再各自调用一次epoll_ctl 而是先写入SQ环,
+ * 到下一次poll()时与"上一轮已触发fd的重新关注"一起 通过一次io_uring_enter()批量提交并等待完成事件
+ * 不依赖liburing 直接使用系统调用和<linux/io_uring.h>
+ *
+ * 另外支持完成模式(proactor)的读写:
+ * 接收用IORING_OP_RECV + 每个loop一个provided buffer ring(IORING_REGISTER_PBUF_RING, 5.19+), 内核直接把数据写入池化的缓冲区
+ * 发送用IORING_OP_SEND 数据先拷贝进loop持有的发送块 保证连接提前销毁时内核不会访问已释放的内存; 部分发送由Poller自动续发
+ */
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    bool completionIoSupported() const override;
+    void submitRecv(Channel *channel) override;
+    size_t submitSend(Channel *channel, const void *data, size_t len) override;
+
+    // 当前内核是否支持本Poller需要的io_uring特性(IORING_FEAT_EXT_ARG, 5.11+)
+    static bool isSupported();
+    // 当前内核是否支持provided buffer ring(5.19+)
+    static bool isCompletionIoSupported();
+
+private:
+    struct PollState // 每个fd在io_uring中的关注状态
+    {
+        uint32_t generation = 0;  // 当前poll请求的代数 用来识别已经过期的完成事件
+        uint32_t armedEvents = 0; // 当前poll请求关注的事件
+        bool armed = false;       // 是否有一个未完成的poll请求
+        uint32_t recvGeneration = 0;
+        uint32_t sendGeneration = 0;
+        bool recvInFlight = false; // 完成模式下是否有未完成的recv/send
+        bool sendInFlight = false;
+        uint64_t round = 0; // 最近一次出现在activeChannels中的poll轮次 同一轮只加入一次
+    };
+    typedef std::vector<PollState> PollStateList; //与channels_一样以fd为下标 只有登记过的fd的状态才有效
+
+    struct SendOp // 一次异步发送 由Poller持有发送块直到内核完成
+    {
+        int fd;
+        char *block;
+        size_t offset;
+        size_t remaining;
+        size_t sent;
+        bool more; // 调用方还有后续数据 用MSG_MORE避免块尾的小分组被Nagle算法推迟
+    };
+    typedef std::map<uint32_t, SendOp> SendOpMap; //key是发送请求的代数
+
+    void setupRing();
+    void drainRequests();
+    io_uring_sqe *getSqe();
+    int submitAndWait(unsigned waitNr, int timeoutMs);
+    unsigned completionsReady() const;
+    int reapCompletions(ChannelList *activeChannels);
+
+    void armPoll(int fd, uint32_t events, PollState *state);
+    void cancelPoll(int fd, PollState *state);
+    void rearmFiredChannels();
+
+    uint32_t nextGeneration();
+    PollState &registerChannel(Channel *channel);
+    void addChannel(Channel *channel);
+    PollState *findState(int fd);
+    void fireChannel(PollState *state, Channel *channel, int revents, ChannelList *activeChannels);
+    void cancelRequest(int fd, uint64_t userData);
+    void queueSend(uint32_t generation, const SendOp &op);
+    void handleRecvCompletion(const io_uring_cqe *cqe, ChannelList *activeChannels);
+    void handleSendCompletion(const io_uring_cqe *cqe, ChannelList *activeChannels);
+    void setupBufferRing();
+    void recycleRecvBuffers();
+
+    int ringfd_;
+    unsigned features_;
+    // SQ环
+    void *sqRing_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *sqArray_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+    unsigned sqeTail_; // 本地已填充的SQ尾 提交时才写回*sqTail_
+    // CQ环
+    void *cqRing_;
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    uint32_t nextGeneration_;
+    PollStateList states_;
+    std::vector<int> firedFds_; // 上一轮poll()中触发过的fd 它们的单次poll请求已经完成 需要重新关注
+    uint64_t round_;
+
+    // 完成模式: 接收缓冲区环 只在第一次submitRecv时创建
+    io_uring_buf_ring *bufRing_;
+    size_t bufRingSize_;
+    char *recvBuffers_;
+    uint16_t bufRingTail_;
+    std::vector<uint16_t> consumedBuffers_; // 上一轮交给Channel的接收缓冲区 下一轮poll()前归还给内核
+    // 完成模式: 发送块的空闲链表与进行中的发送请求
+    std::vector<char *> freeSendBlocks_;
+    SendOpMap sendOps_;
+    unsigned pendingIo_; // 已提交但还没有完成的recv/send请求数(包括已经过期的)
+
+    static const unsigned kRingEntries = 1024;
+    static const unsigned kCompletionEntries = 8192;
+    static const unsigned kRecvBufferCount = 512; // 必须是2的幂
+    static const size_t kRecvBufferSize = 8 * 1024;
+    static const size_t kSendBlockSize = 64 * 1024;
+    static const uint16_t kBufferGroup = 0;
+};
@@ -41,9 +41,8 @@ void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
         if (it->revents > 0)
         {
             --numEvents;
-            auto ch = channels_.find(it->fd);
-            assert(ch != channels_.end());
-            Channel *channel = ch->second;
+            Channel *channel = channels_.find(it->fd);
+            assert(channel != nullptr);
             assert(channel->fd() == it->fd);
             channel->set_revents(it->revents);
             activeChannels->push_back(channel);
@@ -58,7 +57,6 @@ void PollPoller::updateChannel(Channel *channel)
     LOG_TRACE<<"fd = "<<channel->fd()<< " events = "<<channel->events();
     if(channel->index() < 0){ //表示此时的channel还没有加入过PollPoller 因为Channel构造函数的默认值index = -1
         //add new one
-        assert(channels_.find(channel->fd()) == channels_.end());
         pollfd pfd;
         pfd.fd = channel->fd();
         pfd.events = static_cast<short>(channel->events());
@@ -66,13 +64,12 @@ void PollPoller::updateChannel(Channel *channel)
         pollfds_.push_back(pfd);
         int idx = static_cast<int>(pollfds_.size())-1;
         channel ->set_index(idx);
-        channels_[pfd.fd] = channel;
-        //channels_是map,在基类中声明 用来存放PollPoller对象已经联系起来的channel
+        channels_.insert(pfd.fd, channel);
+        //channels_是以fd为下标的登记表,在基类中声明 用来存放PollPoller对象已经联系起来的channel
         //pollfds_是vector 存放的是pollfd类型数组，可以当作::poll()函数的第一个参数
     }else{
         //update existing one
-        assert(channels_.find(channel->fd()) != channels_.end());
-        assert(channels_[channel->fd()] == channel);
+        assert(channels_.find(channel->fd()) == channel);
         int idx = channel ->index();
         assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
 
@@ -92,13 +89,12 @@ void PollPoller::removeChannel(Channel *channel)
 {
     Poller::assertInLoopThread();
     LOG_TRACE << "fd = "<< channel->fd();
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(channels_.find(channel->fd()) == channel);
     assert(channel->isNoEvent());//被移除的channel必须是不被关注的 
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
 
-    size_t n = channels_.erase(channel->fd());//从map中移除 这个channel; 返回删除的个数
+    size_t n = channels_.erase(channel->fd());//从登记表中移除 这个channel; 返回删除的个数
     assert (n == 1);
     //从pollfds_中删除channel代表的fd 采用O(1)的算法: 与最后一个元素交换位置 并pop_back()
     if(pollfds_.size()-1 == idx){
@@ -109,7 +105,7 @@ void PollPoller::removeChannel(Channel *channel)
         if(ChannelFdAtEnd < 0){
             ChannelFdAtEnd = -ChannelFdAtEnd -1;
         }
-        channels_[ChannelFdAtEnd]->set_index(idx);
+        channels_.find(ChannelFdAtEnd)->set_index(idx);
         pollfds_.pop_back();
     }
 
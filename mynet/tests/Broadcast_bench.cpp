@@ -0,0 +1,176 @@
+/**
+ * 同一条消息推给大量连接: 每个连接send(const std::string &)各拷贝一份 与 TcpServer::broadcast(SharedSlice)共享一份
+ * 客户端先不读(接收缓冲区设得很小) 消息大部分留在各连接的输出队列中 扇出结束时统计进程中新增的堆内存
+ * 之后客户端读完所有数据并校验 统计扇出耗时和端到端耗时
+ * 用法: Broadcast_bench [连接数] [消息条数] [消息大小]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <malloc.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// 统计整个进程当前占用的堆内存(按malloc实际分配的大小)
+std::atomic<int64_t> g_liveBytes(0);
+
+void *operator new(size_t size)
+{
+    if (void *p = malloc(size == 0 ? 1 : size))
+    {
+        g_liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        g_liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+const uint16_t kPort = 2021;
+
+typedef std::chrono::steady_clock Clock;
+
+void runBench(const char *name, bool shared, int numConns, int numMessages, size_t size)
+{
+    EventLoop loop;
+    InetAddress listenAddr(kPort, true);
+    TcpServer server(&loop, listenAddr, name);
+    std::vector<TcpConnectionPtr> conns;
+    std::atomic<bool> fannedOut(false);
+    double fanoutSeconds = 0;
+    int64_t queuedBytes = 0;
+
+    auto fanout = [&]()
+    {
+        int64_t before = g_liveBytes.load();
+        auto start = Clock::now();
+        for (int m = 0; m < numMessages; ++m)
+        {
+            std::string message(size, static_cast<char>('a' + m % 26));
+            if (shared)
+            {
+                server.broadcast(SharedSlice(std::move(message)));
+            }
+            else
+            {
+                for (const TcpConnectionPtr &conn : conns)
+                {
+                    conn->send(message);
+                }
+            }
+        }
+        fanoutSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        queuedBytes = g_liveBytes.load() - before;
+        fannedOut = true;
+    };
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conns.push_back(conn);
+            if (static_cast<int>(conns.size()) == numConns)
+            {
+                loop.queueInLoop(fanout);
+            }
+        }
+    });
+    server.start();
+
+    bool ok = true;
+    auto start = Clock::now();
+    std::thread client([&]()
+    {
+        std::vector<pollfd> fds;
+        std::vector<size_t> received(numConns, 0);
+        for (int i = 0; i < numConns; ++i)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+            int rcvbuf = 4096; // 让数据堆在服务端的输出队列里
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+            sockaddr_in addr;
+            bzero(&addr, sizeof addr);
+            sockets::fromIpPort("127.0.0.1", kPort, &addr);
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+            {
+                perror("connect");
+                exit(1);
+            }
+            fds.push_back(pollfd{fd, POLLIN, 0});
+        }
+        while (!fannedOut)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const size_t expected = static_cast<size_t>(numMessages) * size;
+        std::vector<char> buf(64 * 1024);
+        int done = 0;
+        while (done < numConns)
+        {
+            ::poll(fds.data(), fds.size(), -1);
+            for (int i = 0; i < numConns; ++i)
+            {
+                if (!(fds[i].revents & POLLIN))
+                {
+                    continue;
+                }
+                ssize_t n = ::read(fds[i].fd, buf.data(), buf.size());
+                if (n <= 0)
+                {
+                    ok = false;
+                    fds[i].fd = -fds[i].fd - 1; // 不再关注
+                    ++done;
+                    continue;
+                }
+                for (ssize_t k = 0; k < n; ++k, ++received[i])
+                {
+                    ok = ok && buf[k] == static_cast<char>('a' + received[i] / size % 26);
+                }
+                if (received[i] == expected)
+                {
+                    fds[i].fd = -fds[i].fd - 1;
+                    ++done;
+                }
+            }
+        }
+        for (pollfd &pfd : fds)
+        {
+            ::close(pfd.fd < 0 ? -pfd.fd - 1 : pfd.fd);
+        }
+        loop.runAfter(0.2, std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+    client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count() - 0.2;
+    printf("%-10s %5d conns x %3d msgs x %6zu bytes: fan-out %8.3f ms, queued heap %8.1f MB, total %7.3f s%s\n", name,
+           numConns, numMessages, size, fanoutSeconds * 1000, queuedBytes / (1024.0 * 1024), seconds, ok ? "" : "  DATA MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int numConns = argc > 1 ? atoi(argv[1]) : 1000;
+    int numMessages = argc > 2 ? atoi(argv[2]) : 20;
+    size_t size = argc > 3 ? atoi(argv[3]) : 16 * 1024;
+    runBench("send", false, numConns, numMessages, size);
+    runBench("broadcast", true, numConns, numMessages, size);
+}
@@ -0,0 +1,160 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "mynet/ChainBuffer.h"
+#include "mynet/BlockPool.h"
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+const size_t kBlock = BlockPool::kBlockSize;
+
+string makeData(size_t len)
+{
+    string data(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    return data;
+}
+
+// 非阻塞的管道 容量缩到一页时writev写不完整个缓冲区
+struct Pipe
+{
+    int fds[2];
+    explicit Pipe(int capacity)
+    {
+        REQUIRE(::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+        REQUIRE(::fcntl(fds[1], F_SETPIPE_SZ, capacity) >= 0);
+    }
+    ~Pipe()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+    string readAll()
+    {
+        string result;
+        char buf[8192];
+        ssize_t n;
+        while ((n = ::read(fds[0], buf, sizeof buf)) > 0)
+        {
+            result.append(buf, n);
+        }
+        return result;
+    }
+};
+
+TEST_CASE("testChainBufferAppendRetrieveAcrossBlocks")
+{
+    BlockPool pool;
+    ChainBuffer buf(&pool);
+    REQUIRE(buf.readableBytes() == 0);
+    REQUIRE(buf.peek() == nullptr);
+    REQUIRE(buf.peekableBytes() == 0);
+
+    const string data = makeData(2 * kBlock + 7000);
+    buf.append(data);
+    REQUIRE(buf.readableBytes() == data.size());
+    REQUIRE(buf.blockCount() == 3);
+    REQUIRE(pool.blocksInUse() == 3);
+    REQUIRE(buf.peekableBytes() == kBlock); // 只有首块是连续的
+    REQUIRE(string(buf.peek(), 10) == data.substr(0, 10));
+
+    iovec vec[8];
+    REQUIRE(buf.readableIovecs(vec, 8) == 3);
+    REQUIRE(vec[0].iov_len == kBlock);
+    REQUIRE(vec[1].iov_len == kBlock);
+    REQUIRE(vec[2].iov_len == 7000);
+    REQUIRE(buf.readableIovecs(vec, 2) == 2);
+
+    // 跨过第一个块的边界 读空的块立即归还
+    buf.retrieve(kBlock + 100);
+    REQUIRE(buf.readableBytes() == data.size() - kBlock - 100);
+    REQUIRE(buf.blockCount() == 2);
+    REQUIRE(pool.blocksInUse() == 2);
+    REQUIRE(buf.peekableBytes() == kBlock - 100);
+    REQUIRE(string(buf.peek(), 10) == data.substr(kBlock + 100, 10));
+
+    // retrieveAsString也跨过块的边界
+    REQUIRE(buf.retrieveAsString(kBlock) == data.substr(kBlock + 100, kBlock));
+    REQUIRE(buf.blockCount() == 1);
+    REQUIRE(buf.readableBytes() == 6900);
+
+    // 最后一块读空之后留着继续写
+    REQUIRE(buf.retrieveAllAsString() == data.substr(2 * kBlock + 100));
+    REQUIRE(buf.readableBytes() == 0);
+    REQUIRE(buf.blockCount() == 1);
+    REQUIRE(pool.blocksInUse() == 1);
+    buf.append(string("hello"));
+    REQUIRE(buf.blockCount() == 1);
+    REQUIRE(string(buf.peek(), buf.peekableBytes()) == "hello");
+
+    buf.retrieveAll();
+    REQUIRE(buf.blockCount() == 0);
+    REQUIRE(pool.blocksInUse() == 0);
+}
+
+TEST_CASE("testChainBufferReadFd")
+{
+    BlockPool pool;
+    ChainBuffer buf(&pool);
+    Pipe pipe(65536);
+    int savedErrno = 0;
+
+    // 超过一个块的数据: 准备了kMaxReadBlocks个新块 没用上的马上还回去
+    const string data = makeData(2 * kBlock + 500);
+    REQUIRE(::write(pipe.fds[1], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    REQUIRE(buf.readFd(pipe.fds[0], &savedErrno) == static_cast<ssize_t>(data.size()));
+    REQUIRE(buf.readableBytes() == data.size());
+    REQUIRE(buf.blockCount() == 3);
+    REQUIRE(pool.blocksInUse() == 3);
+    REQUIRE(pool.freeBlocks() == ChainBuffer::kMaxReadBlocks - 3);
+
+    // 尾块还有空间: 先读进尾块 新块全部归还
+    REQUIRE(::write(pipe.fds[1], "tail", 4) == 4);
+    REQUIRE(buf.readFd(pipe.fds[0], &savedErrno) == 4);
+    REQUIRE(buf.blockCount() == 3);
+    REQUIRE(pool.blocksInUse() == 3);
+
+    // 没有数据: EAGAIN 块数不变
+    REQUIRE(buf.readFd(pipe.fds[0], &savedErrno) == -1);
+    REQUIRE(savedErrno == EAGAIN);
+    REQUIRE(buf.blockCount() == 3);
+    REQUIRE(pool.blocksInUse() == 3);
+
+    REQUIRE(buf.retrieveAllAsString() == data + "tail");
+}
+
+TEST_CASE("testChainBufferWriteFd")
+{
+    BlockPool pool;
+    ChainBuffer buf(&pool);
+    Pipe pipe(4096);
+    int savedErrno = 0;
+
+    const string data = makeData(3 * kBlock + 123);
+    buf.append(data);
+    string received;
+    ssize_t n = buf.writeFd(pipe.fds[1], &savedErrno);
+    REQUIRE(n > 0);
+    REQUIRE(static_cast<size_t>(n) < data.size());
+    REQUIRE(buf.readableBytes() == data.size() - n);
+    received += pipe.readAll();
+    REQUIRE(received == data.substr(0, n));
+
+    while (buf.readableBytes() > 0)
+    {
+        if (buf.writeFd(pipe.fds[1], &savedErrno) < 0)
+        {
+            REQUIRE(savedErrno == EAGAIN);
+        }
+        received += pipe.readAll();
+    }
+    REQUIRE(received == data);
+    REQUIRE(buf.writeFd(pipe.fds[1], &savedErrno) == 0); // 没有数据可写
+    REQUIRE(buf.blockCount() == 1);
+    REQUIRE(pool.blocksInUse() == 1);
+}
@@ -13,7 +13,6 @@
 #include <sys/timerfd.h> // 将时间点转化为fd事件，时间点未到达时fd阻塞 时间点到达是fd可读
 // muduo将定时器任务通过转变为fd的方式注册到EventLoop中，完成了形式上的统一
 
-using TimerCallback = std::function<void()>;
 int createTimerfd_()
 {
     int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
@@ -78,11 +77,11 @@ private:
     }
 
 public:
-    PeriodicTimer(EventLoop *loop, double interval, const TimerCallback &cb) : loop_(loop),interval_(interval),
+    PeriodicTimer(EventLoop *loop, double interval, TimerCallback cb) : loop_(loop),interval_(interval),
                                                                                timerfd_(createTimerfd_()),
                                                                                timerfdChannel_(loop_, timerfd_),
                                                                                
-                                                                               cb_(cb)
+                                                                               cb_(std::move(cb))
     {
         timerfdChannel_.setReadCallback(std::bind(&PeriodicTimer::handleRead, this));
         timerfdChannel_.enableReading();
@@ -0,0 +1,91 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "base/ConcurrentFreeList.h"
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+using namespace std;
+
+const int kFreers = 4;
+
+TEST_CASE("testConcurrentFreeListReuse")
+{
+    const int kBlocks = 400;
+    const size_t kSize = 64;
+    ConcurrentFreeList list;
+
+    set<void *> first;
+    vector<void *> blocks;
+    for (int i = 0; i < kBlocks; ++i)
+    {
+        void *p = list.allocate(kSize);
+        first.insert(p);
+        blocks.push_back(p);
+    }
+    REQUIRE(first.size() == static_cast<size_t>(kBlocks));
+    REQUIRE(list.freeCount() == 0);
+
+    // 其他线程同时释放 块全部进入共享的空闲栈
+    vector<thread> freers;
+    for (int t = 0; t < kFreers; ++t)
+    {
+        freers.emplace_back([&, t]()
+                            {
+                                for (int i = t; i < kBlocks; i += kFreers)
+                                {
+                                    list.deallocate(blocks[i], kSize);
+                                }
+                            });
+    }
+    for (thread &t : freers)
+    {
+        t.join();
+    }
+    REQUIRE(list.freeCount() == static_cast<size_t>(kBlocks));
+
+    // 所属线程重新分配 拿到的都是刚才释放的块 一个不多一个不少
+    set<void *> second;
+    for (int i = 0; i < kBlocks; ++i)
+    {
+        second.insert(list.allocate(kSize));
+    }
+    REQUIRE(second == first);
+    REQUIRE(list.freeCount() == 0);
+
+    // 其他大小不经过空闲链表
+    void *other = list.allocate(kSize * 2);
+    REQUIRE(first.count(other) == 0);
+    list.deallocate(other, kSize * 2);
+    REQUIRE(list.freeCount() == 0);
+
+    for (void *p : second)
+    {
+        list.deallocate(p, kSize);
+    }
+    REQUIRE(list.freeCount() == static_cast<size_t>(kBlocks));
+}
+
+TEST_CASE("testConcurrentFreeListAllocator")
+{
+    // allocate_shared的对象和控制块在同一个块里 最后一个引用在别的线程释放 块回到所属线程的空闲链表
+    auto list = std::make_shared<ConcurrentFreeList>();
+    ConcurrentFreeListAllocator<int> alloc(list);
+    shared_ptr<int> p = std::allocate_shared<int>(alloc, 42);
+    void *block = p.get();
+    thread([&p]() { p.reset(); }).join();
+    REQUIRE(list->freeCount() == 1);
+
+    shared_ptr<int> q = std::allocate_shared<int>(alloc, 7);
+    REQUIRE(q.get() == block);
+    REQUIRE(list->freeCount() == 0);
+
+    // 分配器持有空闲链表的引用 对象比创建它的地方活得久时链表也还在
+    std::weak_ptr<ConcurrentFreeList> weak = list;
+    list.reset();
+    alloc = ConcurrentFreeListAllocator<int>(std::make_shared<ConcurrentFreeList>());
+    REQUIRE(!weak.expired());
+    q.reset();
+    REQUIRE(weak.expired());
+}
@@ -0,0 +1,114 @@
+/**
+ * 短连接生命周期中的内存分配次数: 替换全局operator new计数 客户端逐个connect -> 读到EOF -> close
+ * 服务端连接建立后立即shutdown 预热之后统计每个连接平均的operator new次数(客户端只用系统调用 不分配)
+ * 用法: ConnectionAlloc_bench [IO线程数] [连接数]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "base/Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+std::atomic<int64_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size == 0 ? 1 : size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+const uint16_t kPort = 2025;
+
+void runClient(int numConns, std::atomic<int64_t> *closed)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char buf[16];
+    for (int i = 0; i < numConns; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) == 0)
+        {
+            while (::read(fd, buf, sizeof buf) > 0)
+            {
+            }
+        }
+        ::close(fd);
+        while (closed->load(std::memory_order_acquire) <= i)
+        { // 等服务端销毁了这个连接 每轮统计的都是完整的生命周期
+            std::this_thread::yield();
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int numThreads = argc > 1 ? atoi(argv[1]) : 1;
+    int numConns = argc > 2 ? atoi(argv[2]) : 20000;
+    const int kWarmup = 1000;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "alloc");
+    server.setThreadNum(numThreads);
+    std::atomic<int64_t> closed(0);
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         conn->shutdown();
+                                     }
+                                     else
+                                     { // 在connectDestroyed中回调
+                                         closed.fetch_add(1, std::memory_order_release);
+                                     }
+                                 });
+    server.start();
+
+    int64_t allocations = 0;
+    double seconds = 0;
+    std::thread driver([&]()
+                       {
+                           runClient(kWarmup, &closed);
+                           closed = 0;
+                           int64_t before = g_allocations.load();
+                           auto start = std::chrono::steady_clock::now();
+                           runClient(numConns, &closed);
+                           seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                           allocations = g_allocations.load() - before;
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    printf("%d io threads %d connections: %.2f operator new per connection, %.0f conns/s\n", numThreads, numConns,
+           static_cast<double>(allocations) / numConns, numConns / seconds);
+}
@@ -0,0 +1,151 @@
+/**
+ * 非IO线程调用TcpConnection::send发送大块响应的开销
+ * 工作线程每次构造一个响应体 分别用拷贝的send(const std::string &)与转移所有权的send(std::string &&)
+ * send(Buffer &&) send(std::unique_ptr<char[]>, size_t)交给IO线程 客户端线程读完全部数据为止
+ * 用法: CrossThreadSend_bench [响应个数] [响应大小]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2018;
+
+typedef std::chrono::steady_clock Clock;
+
+enum Method
+{
+    kCopyString,
+    kMoveString,
+    kMoveBuffer,
+    kUniquePtr,
+};
+
+// 工作线程: 构造响应并交给连接发送 返回花在send调用上的时间
+double produce(const TcpConnectionPtr &conn, Method method, int count, size_t size)
+{
+    double sendSeconds = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        Clock::time_point start;
+        switch (method)
+        {
+        case kCopyString:
+        {
+            std::string body(size, 'x');
+            start = Clock::now();
+            conn->send(body);
+            break;
+        }
+        case kMoveString:
+        {
+            std::string body(size, 'x');
+            start = Clock::now();
+            conn->send(std::move(body));
+            break;
+        }
+        case kMoveBuffer:
+        {
+            Buffer body(size);
+            memset(body.beginWrite(), 'x', size);
+            body.hasWritten(size);
+            start = Clock::now();
+            conn->send(std::move(body));
+            break;
+        }
+        case kUniquePtr:
+        {
+            std::unique_ptr<char[]> body(new char[size]);
+            memset(body.get(), 'x', size);
+            start = Clock::now();
+            conn->send(std::move(body), size);
+            break;
+        }
+        }
+        sendSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return sendSeconds;
+}
+
+void runBench(const char *name, Method method, int count, size_t size)
+{
+    EventLoop loop;
+    InetAddress listenAddr(kPort, true);
+    TcpServer server(&loop, listenAddr, name);
+    std::promise<TcpConnectionPtr> connected;
+    server.setConnectionCallback([&connected](const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            connected.set_value(conn);
+        }
+    });
+    server.start();
+
+    const size_t total = static_cast<size_t>(count) * size;
+    double seconds = 0;
+    double sendSeconds = 0;
+    std::thread client([&]()
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        sockaddr_in addr;
+        bzero(&addr, sizeof addr);
+        sockets::fromIpPort("127.0.0.1", kPort, &addr);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        TcpConnectionPtr conn = connected.get_future().get();
+        auto start = Clock::now();
+        std::thread worker([&]() { sendSeconds = produce(conn, method, count, size); });
+        std::vector<char> buf(256 * 1024);
+        size_t received = 0;
+        while (received < total)
+        {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n <= 0)
+            {
+                fprintf(stderr, "read failed after %zu of %zu bytes\n", received, total);
+                exit(1);
+            }
+            received += n;
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        worker.join();
+        conn.reset();
+        ::close(fd);
+        loop.runAfter(0.2, std::bind(&EventLoop::quit, &loop)); // 等待服务端处理完关闭
+    });
+    loop.loop();
+    client.join();
+
+    printf("%-14s %5d x %7zu bytes: %8.3f s, %8.1f MB/s, %8.2f us per send call\n", name, count, size, seconds,
+           total / seconds / (1024 * 1024), sendSeconds * 1e6 / count);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 256;
+    size_t size = argc > 2 ? atoi(argv[2]) : 256 * 1024;
+
+    runBench("copy string", kCopyString, count, size);
+    runBench("move string", kMoveString, count, size);
+    runBench("move Buffer", kMoveBuffer, count, size);
+    runBench("unique_ptr", kUniquePtr, count, size);
+}
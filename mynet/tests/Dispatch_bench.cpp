@@ -0,0 +1,160 @@
+/**
+ * 新连接的分配策略: 每4个连接里有1个长连接(持续发请求 服务端每个请求忙等200us) 其余3个是建立后马上关闭的短连接
+ * 轮询时长连接全部落在同一个IO线程上 负载类的策略应当把它们分散开
+ * 输出每个IO线程上的长连接数; 客户端都来自127.0.0.1 一致性哈希会把它们全部放在同一个loop上
+ * 用法: Dispatch_bench [IO线程数] [长连接数]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/EventLoopThreadPool.h"
+#include "mynet/InetAddress.h"
+#include "base/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2023;
+const int kShortPerLong = 3;
+
+int connectToServer()
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+int totalConnections(const std::vector<EventLoop *> &loops)
+{
+    int total = 0;
+    for (EventLoop *loop : loops)
+    {
+        total += loop->connectionCount();
+    }
+    return total;
+}
+
+// 等所有连接都记到某个loop上(或从loop上移除)
+void waitConnections(const std::vector<EventLoop *> &loops, int expected)
+{
+    while (totalConnections(loops) != expected)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void runBench(const char *name, EventLoopThreadPool::DispatchPolicy policy, int numThreads, int numLong)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), name);
+    server.setThreadNum(numThreads);
+    server.setDispatchPolicy(policy);
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                              {
+                                  buf->retrieveAll();
+                                  auto start = std::chrono::steady_clock::now();
+                                  while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(200))
+                                  {
+                                  }
+                                  conn->send("k", 1);
+                              });
+    server.start();
+    std::vector<EventLoop *> loops = server.threadPool()->getAllLoops();
+
+    std::vector<int> longOnLoop(loops.size(), 0);
+    std::thread driver([&]()
+                       {
+                           std::vector<int> longFds;
+                           std::vector<std::thread> talkers;
+                           std::atomic<bool> stop(false);
+                           for (int i = 0; i < numLong; ++i)
+                           {
+                               for (int k = 0; k < kShortPerLong; ++k)
+                               {
+                                   int fd = connectToServer();
+                                   waitConnections(loops, static_cast<int>(longFds.size()) + 1);
+                                   ::close(fd);
+                                   waitConnections(loops, static_cast<int>(longFds.size()));
+                               }
+                               // 记下新的长连接落在哪个loop上: 它是唯一增加了连接数的loop
+                               std::vector<int> before;
+                               for (EventLoop *l : loops)
+                               {
+                                   before.push_back(l->connectionCount());
+                               }
+                               int fd = connectToServer();
+                               waitConnections(loops, static_cast<int>(longFds.size()) + 1);
+                               for (size_t j = 0; j < loops.size(); ++j)
+                               {
+                                   if (loops[j]->connectionCount() > before[j])
+                                   {
+                                       ++longOnLoop[j];
+                                   }
+                               }
+                               longFds.push_back(fd);
+                               talkers.emplace_back([fd, &stop]()
+                                                    {
+                                                        char c;
+                                                        while (!stop.load(std::memory_order_relaxed))
+                                                        {
+                                                            if (::write(fd, "q", 1) != 1 || ::read(fd, &c, 1) != 1)
+                                                            {
+                                                                break;
+                                                            }
+                                                        }
+                                                    });
+                           }
+                           stop = true;
+                           for (std::thread &t : talkers)
+                           {
+                               t.join();
+                           }
+                           for (int fd : longFds)
+                           {
+                               ::close(fd);
+                           }
+                           waitConnections(loops, 0);
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+
+    printf("%-18s long connections per loop:", name);
+    int most = 0;
+    for (size_t j = 0; j < loops.size(); ++j)
+    {
+        printf(" %3d", longOnLoop[j]);
+        most = std::max(most, longOnLoop[j]);
+    }
+    printf("   busiest loop holds %d of %d\n", most, numLong);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int numLong = argc > 2 ? atoi(argv[2]) : 16;
+    runBench("round-robin", EventLoopThreadPool::kRoundRobin, numThreads, numLong);
+    runBench("least-connections", EventLoopThreadPool::kLeastConnections, numThreads, numLong);
+    runBench("least-queue", EventLoopThreadPool::kLeastQueue, numThreads, numLong);
+    runBench("least-busy", EventLoopThreadPool::kLeastBusy, numThreads, numLong);
+    runBench("consistent-hash", EventLoopThreadPool::kConsistentHash, numThreads, numLong);
+}
@@ -0,0 +1,158 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "base/MpscQueue.h"
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+using namespace std;
+
+// 只统计生产者线程里的operator new: Catch和线程本身的分配不算
+thread_local bool t_countAllocations = false;
+std::atomic<int64_t> g_producerAllocations(0);
+
+void *operator new(size_t size)
+{
+    if (t_countAllocations)
+    {
+        g_producerAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *p = ::malloc(size == 0 ? 1 : size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{ // Catch用nothrow版本 不替换的话与下面的operator delete不配对
+    if (t_countAllocations)
+    {
+        g_producerAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+const int kProducers = 4;
+
+TEST_CASE("testMpscQueueConcurrentProducers")
+{
+    const int kPerProducer = 20000;
+    MpscQueue<uint64_t> queue;
+    vector<thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&queue, p]()
+                               {
+                                   for (int i = 0; i < kPerProducer; ++i)
+                                   {
+                                       queue.push((static_cast<uint64_t>(p) << 32) | i);
+                                   }
+                               });
+    }
+
+    // 每个生产者自己的元素保持先后顺序 总数不多不少
+    vector<int64_t> next(kProducers, 0);
+    int received = 0;
+    bool ordered = true;
+    while (received < kProducers * kPerProducer)
+    {
+        uint64_t value;
+        if (!queue.pop(&value))
+        {
+            std::this_thread::yield(); // 生产者可能停在exchange和链接next之间
+            continue;
+        }
+        int p = static_cast<int>(value >> 32);
+        int64_t seq = static_cast<int64_t>(value & 0xffffffff);
+        ordered = ordered && p < kProducers && seq == next[p];
+        ++next[p];
+        ++received;
+    }
+    for (thread &t : producers)
+    {
+        t.join();
+    }
+    REQUIRE(ordered);
+    uint64_t extra;
+    REQUIRE(!queue.pop(&extra));
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("testMpscQueueNodeReuse")
+{
+    const int kRounds = 200;
+    const int kPerRound = 100;
+    MpscQueue<int> queue;
+    std::atomic<int> round(0);
+    std::atomic<int> done(0);
+    g_producerAllocations = 0;
+
+    // 每一轮各生产者并发push 消费者全部取走之后进入下一轮 取走的节点回到全局空闲栈给下一轮复用
+    vector<thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&]()
+                               {
+                                   t_countAllocations = true;
+                                   for (int r = 0; r < kRounds; ++r)
+                                   {
+                                       while (round.load(std::memory_order_acquire) < r)
+                                       {
+                                           std::this_thread::yield();
+                                       }
+                                       for (int i = 0; i < kPerRound; ++i)
+                                       {
+                                           queue.push(i);
+                                       }
+                                       done.fetch_add(1, std::memory_order_release);
+                                   }
+                                   t_countAllocations = false;
+                               });
+    }
+
+    int popped = 0;
+    for (int r = 0; r < kRounds; ++r)
+    {
+        while (popped < (r + 1) * kProducers * kPerRound)
+        {
+            int value;
+            if (queue.pop(&value))
+            {
+                ++popped;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        while (done.load(std::memory_order_acquire) < (r + 1) * kProducers)
+        {
+            std::this_thread::yield();
+        }
+        round.store(r + 1, std::memory_order_release);
+    }
+    for (thread &t : producers)
+    {
+        t.join();
+    }
+
+    // 不复用时每次push都要分配一个节点
+    int64_t pushes = static_cast<int64_t>(kRounds) * kProducers * kPerRound;
+    INFO("producer allocations " << g_producerAllocations.load() << " for " << pushes << " pushes");
+    REQUIRE(g_producerAllocations.load() < pushes / 10);
+}
@@ -0,0 +1,165 @@
+/**
+ * 流水线大响应在输出缓冲区中排队时的开销
+ * 对端读得慢 每轮追加一批响应 再尝试写一次 最后写到空为止
+ * 比较原先连续的Buffer(拷贝追加 write 必要时扩容/makeSpace搬移) 由16KB块串成的ChainBuffer(拷贝追加 writev)
+ * 以及OutputQueue(拷贝进池中的块 或者移交所有权 writev)
+ * 接收端按字节校验顺序 确保切片链没有错位
+ * 用法: OutputQueue_bench [响应个数] [响应大小] [每批个数]
+ */
+#include "mynet/OutputQueue.h"
+#include "mynet/ChainBuffer.h"
+#include "mynet/Buffer.h"
+#include "mynet/SocketsOps.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// 第i个响应的内容由i决定 接收端可以按同样的规则校验
+std::string makeResponse(int i, size_t size)
+{
+    std::string body(size, static_cast<char>('a' + i % 26));
+    body[0] = static_cast<char>('A' + i % 26);
+    return body;
+}
+
+void waitWritable(int fd)
+{
+    pollfd pfd = {fd, POLLOUT, 0};
+    ::poll(&pfd, 1, -1);
+}
+
+struct ContiguousOutput
+{
+    Buffer buffer;
+    size_t readableBytes() const { return buffer.readableBytes(); }
+    void append(std::string &&body) { buffer.append(body); }
+    void write(int fd)
+    {
+        ssize_t n = sockets::write(fd, buffer.peek(), buffer.readableBytes());
+        if (n > 0)
+        {
+            buffer.retrieve(n);
+        }
+    }
+};
+
+struct ChainOutput
+{
+    BlockPool pool;
+    ChainBuffer buffer{&pool};
+    size_t readableBytes() const { return buffer.readableBytes(); }
+    void append(std::string &&body) { buffer.append(body); }
+    void write(int fd)
+    {
+        int savedErrno = 0;
+        buffer.writeFd(fd, &savedErrno);
+    }
+};
+
+template <bool kMove>
+struct QueuedOutput
+{
+    BlockPool pool;
+    OutputQueue queue{&pool};
+    size_t readableBytes() const { return queue.readableBytes(); }
+    void append(std::string &&body)
+    {
+        if (kMove)
+        {
+            queue.append(OutputSlice(std::move(body)));
+        }
+        else
+        {
+            queue.append(body.data(), body.size());
+        }
+    }
+    void write(int fd)
+    {
+        int savedErrno = 0;
+        queue.writeFd(fd, &savedErrno);
+    }
+};
+
+template <typename Output>
+void runBench(const char *name, int count, size_t size, int batch)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+    ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    bool ok = true;
+    std::thread reader([&]()
+    {
+        std::vector<char> buf(64 * 1024);
+        size_t offset = 0;
+        const size_t total = static_cast<size_t>(count) * size;
+        while (offset < total)
+        {
+            ssize_t n = ::read(fds[1], buf.data(), buf.size());
+            if (n <= 0)
+            {
+                ok = false;
+                break;
+            }
+            for (ssize_t k = 0; k < n; ++k, ++offset)
+            {
+                int i = static_cast<int>(offset / size);
+                char expect = offset % size == 0 ? static_cast<char>('A' + i % 26) : static_cast<char>('a' + i % 26);
+                if (buf[k] != expect)
+                {
+                    ok = false;
+                }
+            }
+        }
+    });
+
+    Output output;
+    size_t peak = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < count;)
+    {
+        for (int b = 0; b < batch && i < count; ++b, ++i)
+        {
+            output.append(makeResponse(i, size));
+        }
+        peak = std::max(peak, output.readableBytes());
+        output.write(fds[0]);
+    }
+    while (output.readableBytes() > 0)
+    {
+        waitWritable(fds[0]);
+        output.write(fds[0]);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::shutdown(fds[0], SHUT_WR);
+    reader.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    printf("%-12s %5d x %7zu bytes, batch %3d: %8.3f s, %8.1f MB/s, peak queued %6.1f MB%s\n", name, count, size,
+           batch, seconds, count * size / seconds / (1024 * 1024), peak / (1024.0 * 1024), ok ? "" : "  DATA MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 512;
+    size_t size = argc > 2 ? atoi(argv[2]) : 256 * 1024;
+    int batch = argc > 3 ? atoi(argv[3]) : 16;
+    runBench<ContiguousOutput>("Buffer", count, size, batch);
+    runBench<ChainOutput>("ChainBuffer", count, size, batch);
+    runBench<QueuedOutput<false>>("Queue(copy)", count, size, batch);
+    runBench<QueuedOutput<true>>("Queue(move)", count, size, batch);
+}
@@ -0,0 +1,182 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "mynet/OutputQueue.h"
+#include "mynet/BlockPool.h"
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+using namespace std;
+
+// 非阻塞的管道 容量缩到一页时writev写不完整个队列
+// 一页的管道只有一个缓冲槽 里面有数据时sendfile(splice)拿不到槽 返回EAGAIN 发送文件要用默认的容量
+struct Pipe
+{
+    int fds[2];
+    explicit Pipe(int capacity)
+    {
+        REQUIRE(::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+        REQUIRE(::fcntl(fds[1], F_SETPIPE_SZ, capacity) >= 0);
+    }
+    ~Pipe()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+    string readAll()
+    {
+        string result;
+        char buf[8192];
+        ssize_t n;
+        while ((n = ::read(fds[0], buf, sizeof buf)) > 0)
+        {
+            result.append(buf, n);
+        }
+        return result;
+    }
+};
+
+TEST_CASE("testOutputQueueRetrieveAcrossSlices")
+{
+    BlockPool pool;
+    OutputQueue queue(&pool);
+    queue.append(OutputSlice(string(100, 'a')));
+    queue.append(string(50, 'b').data(), 50); // 拷贝进块
+    unique_ptr<char[]> data(new char[30]);
+    memset(data.get(), 'c', 30);
+    queue.append(OutputSlice(std::move(data), 30));
+    REQUIRE(queue.sliceCount() == 3);
+    REQUIRE(queue.readableBytes() == 180);
+    REQUIRE(pool.blocksInUse() == 1);
+
+    queue.retrieve(120); // 第一段整段 第二段一部分
+    REQUIRE(queue.sliceCount() == 2);
+    REQUIRE(queue.readableBytes() == 60);
+    REQUIRE(string(queue.front().data(), queue.front().size()) == string(30, 'b'));
+
+    queue.retrieve(30); // 正好到切片边界 块归还
+    REQUIRE(queue.sliceCount() == 1);
+    REQUIRE(pool.blocksInUse() == 0);
+
+    queue.retrieveAll();
+    REQUIRE(queue.empty());
+    REQUIRE(queue.sliceCount() == 0);
+}
+
+TEST_CASE("testOutputQueuePartialWritev")
+{
+    BlockPool pool;
+    OutputQueue queue(&pool);
+    Pipe pipe(4096);
+
+    string expected = string(3000, 'a') + string(2000, 'b') + string(1500, 'c') + string(10, 'd');
+    queue.append(OutputSlice(string(3000, 'a')));
+    queue.append(string(2000, 'b').data(), 2000);
+    queue.append(OutputSlice(string(1500, 'c')));
+    queue.append(OutputSlice(string(10, 'd')));
+    REQUIRE(queue.sliceCount() == 4);
+    REQUIRE(queue.readableBytes() == expected.size());
+
+    string received;
+    int savedErrno = 0;
+    ssize_t n = queue.writeFd(pipe.fds[1], &savedErrno);
+    REQUIRE(n > 3000); // 写过了第一段
+    REQUIRE(static_cast<size_t>(n) < expected.size());
+    REQUIRE(queue.readableBytes() == expected.size() - n);
+    REQUIRE(queue.sliceCount() < 4);
+    received += pipe.readAll();
+    REQUIRE(received == expected.substr(0, n));
+
+    // 管道满了: 什么都没有写 队列不变
+    while (queue.writeFd(pipe.fds[1], &savedErrno) > 0)
+    {
+    }
+    size_t before = queue.readableBytes();
+    if (before > 0)
+    {
+        REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == -1);
+        REQUIRE(savedErrno == EAGAIN);
+        REQUIRE(queue.readableBytes() == before);
+    }
+
+    while (!queue.empty())
+    {
+        received += pipe.readAll();
+        queue.writeFd(pipe.fds[1], &savedErrno);
+    }
+    received += pipe.readAll();
+    REQUIRE(received == expected);
+    REQUIRE(queue.sliceCount() == 0);
+    REQUIRE(pool.blocksInUse() == 0);
+}
+
+TEST_CASE("testOutputQueueTruncatedFile")
+{
+    BlockPool pool;
+    OutputQueue queue(&pool);
+    Pipe pipe(65536);
+
+    char path[] = "/tmp/OutputQueue_testXXXXXX";
+    int fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    ::unlink(path);
+    REQUIRE(::write(fd, "0123456789", 10) == 10);
+
+    queue.append(OutputSlice(string("head")));
+    queue.append(OutputSlice(FileRange(fd), 0, 1000)); // 排队之后文件只剩10个字节
+    queue.append(OutputSlice(string("tail")));
+    REQUIRE(queue.readableBytes() == 1008);
+    REQUIRE(queue.memoryBytes() == 8);
+
+    int savedErrno = 0;
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == 4); // writev遇到文件区间停下
+    REQUIRE(queue.front().isFile());
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == 10);
+    REQUIRE(queue.readableBytes() == 994);
+
+    // sendfile返回0: 丢弃剩下的区间 当作有进展
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == 0);
+    REQUIRE(queue.readableBytes() == 4);
+    REQUIRE(queue.memoryBytes() == 4);
+    REQUIRE(queue.sliceCount() == 1);
+    REQUIRE(!queue.front().isFile());
+
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == 4);
+    REQUIRE(queue.empty());
+    REQUIRE(pipe.readAll() == "head0123456789tail");
+
+    // 文件整个被截断并且是最后一段: 丢弃之后队列变空
+    char emptyPath[] = "/tmp/OutputQueue_testXXXXXX";
+    fd = ::mkstemp(emptyPath);
+    REQUIRE(fd >= 0);
+    ::unlink(emptyPath);
+    queue.append(OutputSlice(FileRange(fd), 0, 100));
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == 0);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("testOutputQueueZeroCopyEligible")
+{
+    BlockPool pool;
+    OutputQueue queue(&pool);
+    Pipe pipe(65536);
+    queue.setZeroCopyThreshold(1024);
+
+    REQUIRE(queue.zeroCopyEligible(OutputSlice(string(2000, 'a'))));
+    REQUIRE(!queue.zeroCopyEligible(OutputSlice(string(1000, 'a')))); // 小于阈值
+
+    // 拷贝进块的数据即使超过阈值也走writev 不会被钉住等完成通知(管道上MSG_ZEROCOPY会失败)
+    string data(20000, 'b');
+    queue.append(data.data(), data.size());
+    REQUIRE(queue.sliceCount() == 2);
+    REQUIRE(!queue.zeroCopyEligible(queue.front()));
+    int savedErrno = 0;
+    REQUIRE(queue.writeFd(pipe.fds[1], &savedErrno) == static_cast<ssize_t>(data.size()));
+    REQUIRE(queue.empty());
+    REQUIRE(queue.pinnedSlices() == 0);
+    REQUIRE(pool.blocksInUse() == 0);
+    REQUIRE(pipe.readAll() == data);
+}
@@ -0,0 +1,180 @@
+/**
+ * 大量Channel登记在Poller中时 updateChannel/removeChannel/poll的开销
+ * 第一部分只比较登记表本身: std::map<int, Channel *> 与以fd为下标的ChannelTable
+ * 第二部分用真实的eventfd 对epoll/poll/io_uring三种Poller分别测量注册 修改 轮询 移除的耗时
+ * 用法: PollerChannels_bench [channel数] [轮询次数] [每轮就绪的channel数]
+ */
+#include "mynet/ChannelTable.h"
+#include "mynet/Channel.h"
+#include "mynet/EventLoop.h"
+#include "base/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPerOp(Clock::time_point start, size_t ops)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(ops);
+}
+
+// fd在实际中是稠密的 这里模拟每轮就绪的fd分散在整个区间
+template <typename Registry>
+void benchRegistry(const char *name, Registry &registry, int n, int rounds)
+{
+    Channel *fake = reinterpret_cast<Channel *>(uintptr_t(0x1000));
+    auto start = Clock::now();
+    for (int fd = 0; fd < n; ++fd)
+    {
+        registry.insert(fd, fake);
+    }
+    double insertNs = nsPerOp(start, n);
+
+    start = Clock::now();
+    size_t found = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (int fd = r % 7; fd < n; fd += 7)
+        {
+            found += registry.find(fd) != nullptr;
+        }
+    }
+    double findNs = nsPerOp(start, found);
+
+    start = Clock::now();
+    for (int fd = 0; fd < n; ++fd)
+    {
+        registry.erase(fd);
+    }
+    double eraseNs = nsPerOp(start, n);
+    printf("%-14s %7d fds: insert %6.1f ns, find %6.1f ns, erase %6.1f ns\n", name, n, insertNs, findNs, eraseNs);
+}
+
+// 与原先的Poller::channels_相同的std::map 接口与ChannelTable对齐
+struct MapRegistry
+{
+    std::map<int, Channel *> channels;
+    void insert(int fd, Channel *channel) { channels[fd] = channel; }
+    Channel *find(int fd) const
+    {
+        auto it = channels.find(fd);
+        return it == channels.end() ? nullptr : it->second;
+    }
+    size_t erase(int fd) { return channels.erase(fd); }
+};
+
+void benchPoller(const char *name, int n, int rounds, int ready)
+{
+    EventLoop loop;
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<Channel>> channels;
+    int fired = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0)
+        {
+            LOG_SYSFATAL << "eventfd";
+        }
+        fds.push_back(fd);
+        channels.emplace_back(new Channel(&loop, fd));
+        channels.back()->setReadCallback([&](Timestamp)
+        {
+            if (++fired == rounds * ready)
+            {
+                loop.quit();
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    for (auto &ch : channels)
+    {
+        ch->enableReading();
+    }
+    double addNs = nsPerOp(start, n);
+
+    start = Clock::now();
+    for (auto &ch : channels)
+    {
+        ch->enableWriting(); // eventfd一直可写 马上撤销 只测量修改的开销
+        ch->disableWriting();
+    }
+    double modNs = nsPerOp(start, 2 * n);
+
+    // eventfd计数非零时一直可读 电平触发下每轮都会就绪
+    uint64_t one = 1;
+    for (int i = 0; i < ready; ++i)
+    {
+        ::write(fds[static_cast<size_t>(i) * n / ready], &one, sizeof one);
+    }
+    int64_t iterations = loop.iteration();
+    start = Clock::now();
+    loop.loop();
+    iterations = loop.iteration() - iterations;
+    double pollUs = nsPerOp(start, iterations) / 1000;
+
+    start = Clock::now();
+    for (auto &ch : channels)
+    {
+        ch->disableAll();
+        ch->remove();
+    }
+    double removeNs = nsPerOp(start, n);
+    printf("%-8s %7d channels: add %7.1f ns, modify %7.1f ns, poll(%d ready) %8.1f us, remove %7.1f ns\n",
+           name, n, addNs, modNs, ready, pollUs, removeNs);
+
+    channels.clear();
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+    int ready = argc > 3 ? atoi(argv[3]) : 64;
+
+    MapRegistry map;
+    benchRegistry("std::map", map, n, 20);
+    ChannelTable table;
+    benchRegistry("ChannelTable", table, n, 20);
+
+    // 每个channel一个eventfd 尽量调高fd上限 调不上去就按上限减少channel数
+    rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    rlim_t need = static_cast<rlim_t>(n) + 64;
+    if (limit.rlim_cur < need)
+    {
+        limit.rlim_cur = need;
+        limit.rlim_max = std::max(need, limit.rlim_max);
+        if (::setrlimit(RLIMIT_NOFILE, &limit) < 0)
+        {
+            ::getrlimit(RLIMIT_NOFILE, &limit);
+            n = static_cast<int>(limit.rlim_cur) - 64;
+            fprintf(stderr, "RLIMIT_NOFILE is %ld, only %d channels\n", static_cast<long>(limit.rlim_cur), n);
+        }
+    }
+
+    ::unsetenv("MUDUO_USE_POLL");
+    ::unsetenv("MUDUO_USE_IOURING");
+    benchPoller("epoll", n, rounds, ready);
+    ::setenv("MUDUO_USE_POLL", "1", 1);
+    benchPoller("poll", n, rounds / 10, ready); // poll(2)每轮都要扫描全部fd 少跑几轮
+    ::unsetenv("MUDUO_USE_POLL");
+    ::setenv("MUDUO_USE_IOURING", "1", 1);
+    benchPoller("io_uring", n, rounds, ready);
+}
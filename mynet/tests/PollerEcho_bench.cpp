@@ -0,0 +1,157 @@
+/**
+ * epoll 与 io_uring 两种Poller的echo对比测试
+ * 同一进程内依次用两种Poller(以及epoll的边沿触发模式 io_uring的完成模式)启动echo服务器 先建立若干空闲连接 再由客户端线程做ping-pong
+ * 用法: PollerEcho_bench [活跃连接数] [每个连接的往返次数] [空闲连接数] [消息大小]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2017;
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true); // ping-pong测试 避免Nagle算法和延迟确认拖慢往返
+    }
+}
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    sockaddr_in addr;
+    bzero(&addr, sizeof addr);
+    sockets::fromIpPort("127.0.0.1", port, &addr);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+bool readFully(int fd, char *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0)
+        {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+// 每个客户端线程一个连接 同步地发送消息并等待回显
+void pingpong(int rounds, size_t msgSize)
+{
+    int fd = connectTo(kPort);
+    std::string msg(msgSize, 'x');
+    std::vector<char> buf(msgSize);
+    for (int i = 0; i < rounds; ++i)
+    {
+        if (::write(fd, msg.data(), msg.size()) != static_cast<ssize_t>(msg.size()) ||
+            !readFully(fd, buf.data(), buf.size()))
+        {
+            fprintf(stderr, "echo failed\n");
+            break;
+        }
+    }
+    ::close(fd);
+}
+
+enum Mode
+{
+    kLevelTriggered,
+    kEdgeTriggered,
+    kCompletion,
+};
+
+void runBench(const char *name, int clients, int rounds, int idle, size_t msgSize, Mode mode = kLevelTriggered)
+{
+    EventLoop loop;
+    InetAddress listenAddr(kPort, true);
+    TcpServer server(&loop, listenAddr, name);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setEdgeTriggered(mode == kEdgeTriggered);
+    server.setCompletionMode(mode == kCompletion);
+    server.start();
+
+    int64_t extraBufBytes = Buffer::totalExtraBufBytes();
+    double seconds = 0;
+    std::thread client([&]()
+    {
+        std::vector<int> idleFds;
+        for (int i = 0; i < idle; ++i)
+        {
+            idleFds.push_back(connectTo(kPort));
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < clients; ++i)
+        {
+            threads.emplace_back(pingpong, rounds, msgSize);
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (int fd : idleFds)
+        {
+            ::close(fd);
+        }
+        loop.runAfter(0.5, std::bind(&EventLoop::quit, &loop)); // 等待服务端处理完关闭
+    });
+    loop.loop();
+    client.join();
+
+    double total = static_cast<double>(clients) * rounds;
+    printf("%-10s clients %4d idle %6d msg %6zu bytes: %8.3f s, %10.0f round trips/s, loop iterations %lld, elided updates %lld, "
+           "extrabuf copied %lld bytes\n",
+           name, clients, idle, msgSize, seconds, total / seconds, static_cast<long long>(loop.iteration()),
+           static_cast<long long>(loop.elidedChannelUpdates()),
+           static_cast<long long>(Buffer::totalExtraBufBytes() - extraBufBytes));
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int clients = argc > 1 ? atoi(argv[1]) : 8;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10000;
+    int idle = argc > 3 ? atoi(argv[3]) : 1000;
+    size_t msgSize = argc > 4 ? atoi(argv[4]) : 64;
+
+    ::unsetenv("MUDUO_USE_IOURING");
+    runBench("epoll", clients, rounds, idle, msgSize);
+    runBench("epoll-et", clients, rounds, idle, msgSize, kEdgeTriggered);
+
+    ::setenv("MUDUO_USE_IOURING", "1", 1);
+    runBench("io_uring", clients, rounds, idle, msgSize);
+    runBench("uring-cqe", clients, rounds, idle, msgSize, kCompletion); // 完成模式的recv/send
+}
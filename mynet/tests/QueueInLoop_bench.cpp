@@ -0,0 +1,243 @@
+/**
+ * 多个线程同时向一个EventLoop投递任务时的开销
+ * 第一部分只比较队列本身: 原先的mutex + std::vector(消费者整体swap) 与无锁的MpscQueue
+ * 第二部分通过EventLoop::queueInLoop端到端测量 并统计loop迭代次数(约等于被唤醒的次数)
+ * 第三部分统计稳定状态下每次跨线程投递的堆分配次数: std::function + 每次new节点 与 InplaceTask + 复用节点
+ * 用法: QueueInLoop_bench [每个生产者投递的任务数]
+ */
+#include "base/MpscQueue.h"
+#include "mynet/EventLoop.h"
+#include "base/Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef std::function<void()> Functor;
+typedef std::chrono::steady_clock Clock;
+
+// 统计整个进程的operator new调用次数
+std::atomic<int64_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// 原先EventLoop中的实现
+class MutexQueue
+{
+public:
+    void push(Functor f)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        functors_.push_back(std::move(f));
+    }
+    size_t drain()
+    {
+        std::vector<Functor> functors;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            functors.swap(functors_);
+        }
+        for (const Functor &f : functors)
+        {
+            f();
+        }
+        return functors.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Functor> functors_;
+};
+
+class LockFreeQueue
+{
+public:
+    void push(Functor f) { queue_.push(std::move(f)); }
+    size_t drain()
+    {
+        size_t n = 0;
+        Functor f;
+        while (queue_.pop(&f))
+        {
+            f();
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    MpscQueue<Functor> queue_;
+};
+
+template <typename Queue>
+double benchQueue(int producers, int perProducer)
+{
+    Queue queue;
+    int64_t sum = 0;
+    const size_t total = static_cast<size_t>(producers) * perProducer;
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, &sum, perProducer]()
+        {
+            for (int i = 0; i < perProducer; ++i)
+            {
+                queue.push([&sum]() { ++sum; }); // 只在消费者线程执行
+            }
+        });
+    }
+    size_t consumed = 0;
+    while (consumed < total)
+    {
+        size_t n = queue.drain();
+        if (n == 0)
+        {
+            std::this_thread::yield();
+        }
+        consumed += n;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    if (sum != static_cast<int64_t>(total))
+    {
+        fprintf(stderr, "lost tasks: %lld of %zu\n", static_cast<long long>(sum), total);
+        exit(1);
+    }
+    return total / seconds;
+}
+
+void benchEventLoop(int producers, int perProducer)
+{
+    EventLoop loop;
+    const int64_t total = static_cast<int64_t>(producers) * perProducer;
+    int64_t done = 0;
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&]()
+        {
+            while (!go.load())
+            {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < perProducer; ++i)
+            {
+                loop.queueInLoop([&]()
+                {
+                    if (++done == total)
+                    {
+                        loop.quit();
+                    }
+                });
+            }
+        });
+    }
+    auto start = Clock::now();
+    go = true;
+    loop.loop();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    printf("queueInLoop  %2d producers: %10.0f tasks/s, %8lld loop iterations for %lld tasks\n",
+           producers, total / seconds, static_cast<long long>(loop.iteration()), static_cast<long long>(total));
+}
+
+struct Session
+{
+    void onMessage(const std::shared_ptr<int> &guard, int64_t *count) { *count += *guard; }
+};
+
+// 与TcpConnection中常见的任务形式相同: bind(成员函数, this, shared_ptr, 参数)
+template <typename Queue>
+double allocationsPerTask(int tasks)
+{
+    Queue queue;
+    Session session;
+    auto guard = std::make_shared<int>(1);
+    int64_t count = 0;
+    auto produce = [&](int n)
+    {
+        std::thread producer([&]()
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                queue.push(std::bind(&Session::onMessage, &session, guard, &count));
+            }
+        });
+        producer.join();
+        queue.drain();
+    };
+    produce(tasks); // 预热 让节点缓存达到稳定状态
+    int64_t before = g_allocations.load();
+    produce(tasks);
+    return static_cast<double>(g_allocations.load() - before) / tasks;
+}
+
+// 新版EventLoop使用的组合
+class InplaceQueue
+{
+public:
+    void push(InplaceTask f) { queue_.push(std::move(f)); }
+    size_t drain()
+    {
+        size_t n = 0;
+        InplaceTask f;
+        while (queue_.pop(&f))
+        {
+            f();
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    MpscQueue<InplaceTask> queue_;
+};
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    const int totalTasks = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int producerCounts[] = {1, 2, 4, 8, 16, 32, 64};
+    for (int producers : producerCounts)
+    {
+        int perProducer = totalTasks / producers;
+        double mutexRate = benchQueue<MutexQueue>(producers, perProducer);
+        double lockFreeRate = benchQueue<LockFreeQueue>(producers, perProducer);
+        printf("raw queue    %2d producers: mutex+vector %10.0f tasks/s, MpscQueue %10.0f tasks/s\n",
+               producers, mutexRate, lockFreeRate);
+    }
+    for (int producers : producerCounts)
+    {
+        benchEventLoop(producers, totalTasks / producers);
+    }
+    // 线程创建本身也会分配 这里的任务数足够大 可以忽略
+    printf("allocations per task: mutex+vector(std::function) %.3f, MpscQueue(std::function) %.3f, "
+           "MpscQueue(InplaceTask) %.3f\n",
+           allocationsPerTask<MutexQueue>(1000), allocationsPerTask<LockFreeQueue>(1000),
+           allocationsPerTask<InplaceQueue>(1000));
+}
@@ -0,0 +1,93 @@
+/**
+ * 短连接的建立速率: 所有连接在main loop中accept再转交IO线程 与 kReusePortPerLoop每个IO线程各自accept
+ * 服务端连接建立后立即shutdown 客户端线程不断地connect -> 读到EOF -> close 统计每秒完成的连接数
+ * 用法: ReusePort_bench [IO线程数] [客户端线程数] [每种模式的秒数]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "base/Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2022;
+
+void runClient(std::atomic<bool> *stop, std::atomic<int64_t> *completed)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char buf[16];
+    while (!stop->load(std::memory_order_relaxed))
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) == 0)
+        {
+            while (::read(fd, buf, sizeof buf) > 0)
+            {
+            }
+            completed->fetch_add(1, std::memory_order_relaxed);
+        }
+        ::close(fd);
+    }
+}
+
+void runBench(const char *name, TcpServer::Option option, int numThreads, int numClients, double seconds)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), name, option);
+    server.setThreadNum(numThreads);
+    std::atomic<int64_t> accepted(0);
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         accepted.fetch_add(1, std::memory_order_relaxed);
+                                         conn->shutdown();
+                                     }
+                                 });
+    server.start();
+
+    std::atomic<bool> stop(false);
+    std::atomic<int64_t> completed(0);
+    std::thread driver([&]()
+                       { // 客户端全部退出之后才能停止server 否则已经进入backlog的连接没人accept 客户端一直读不到EOF
+                           std::vector<std::thread> clients;
+                           for (int i = 0; i < numClients; ++i)
+                           {
+                               clients.emplace_back(runClient, &stop, &completed);
+                           }
+                           std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+                           stop = true;
+                           for (std::thread &t : clients)
+                           {
+                               t.join();
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    printf("%-16s %d io threads %d clients: %8.0f conns/s (accepted %lld)\n", name, numThreads, numClients,
+           completed.load() / seconds, static_cast<long long>(accepted.load()));
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int numClients = argc > 2 ? atoi(argv[2]) : 8;
+    double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    runBench("main-loop", TcpServer::kNoReusePort, numThreads, numClients, seconds);
+    runBench("reuseport/loop", TcpServer::kReusePortPerLoop, numThreads, numClients, seconds);
+}
@@ -0,0 +1,189 @@
+/**
+ * 通过TcpConnection发送大文件: sendFile(sendfile(2)) 与 先读进用户态再send
+ * 每个连接发送 头部字符串 + 文件 + 尾部字符串 客户端校验内容和顺序(文件区间与内存数据交错排队)
+ * 同时统计整个进程消耗的CPU时间 客户端读取的开销两种方式相同
+ * 用法: SendFile_bench [文件大小MB] [每种方式发送的次数]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2019;
+const char kHeader[] = "BEGIN\n";
+const char kTrailer[] = "END\n";
+
+typedef std::chrono::steady_clock Clock;
+
+char fileByte(size_t offset)
+{
+    return static_cast<char>(offset % 251);
+}
+
+int createFile(size_t size)
+{
+    char path[] = "/tmp/SendFile_bench.XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+    {
+        LOG_SYSFATAL << "mkstemp";
+    }
+    ::unlink(path);
+    std::vector<char> buf(1024 * 1024);
+    for (size_t offset = 0; offset < size;)
+    {
+        size_t n = std::min(buf.size(), size - offset);
+        for (size_t i = 0; i < n; ++i)
+        {
+            buf[i] = fileByte(offset + i);
+        }
+        if (::write(fd, buf.data(), n) != static_cast<ssize_t>(n))
+        {
+            LOG_SYSFATAL << "write";
+        }
+        offset += n;
+    }
+    return fd;
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// 原先的做法: 按块读进内存再交给连接
+void sendByReading(const TcpConnectionPtr &conn, int fd, size_t size)
+{
+    const size_t kChunk = 1024 * 1024;
+    for (size_t offset = 0; offset < size; offset += kChunk)
+    {
+        size_t n = std::min(kChunk, size - offset);
+        std::string chunk(n, '\0');
+        if (::pread(fd, &chunk[0], n, offset) != static_cast<ssize_t>(n))
+        {
+            LOG_SYSFATAL << "pread";
+        }
+        conn->send(std::move(chunk));
+    }
+}
+
+void runBench(const char *name, bool useSendFile, int fileFd, size_t size, int rounds, bool completion = false)
+{
+    EventLoop loop;
+    InetAddress listenAddr(kPort, true);
+    TcpServer server(&loop, listenAddr, name);
+    server.setCompletionMode(completion); // io_uring完成模式没有sendfile 文件内容要先pread到用户态
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->send(std::string(kHeader));
+            if (useSendFile)
+            {
+                conn->sendFile(fileFd, 0, size);
+            }
+            else
+            {
+                sendByReading(conn, fileFd, size);
+            }
+            conn->send(std::string(kTrailer));
+            conn->shutdown(); // 全部发送完之后才会真正关闭写端
+        }
+    });
+    server.start();
+
+    bool ok = true;
+    double cpuStart = cpuSeconds();
+    auto start = Clock::now();
+    std::thread client([&]()
+    {
+        const size_t headerLen = strlen(kHeader);
+        const size_t expected = headerLen + size + strlen(kTrailer);
+        std::vector<char> buf(256 * 1024);
+        std::vector<char> reference(buf.size() + 251);
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            reference[i] = fileByte(i);
+        }
+        for (int r = 0; r < rounds; ++r)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+            sockaddr_in addr;
+            bzero(&addr, sizeof addr);
+            sockets::fromIpPort("127.0.0.1", kPort, &addr);
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+            {
+                perror("connect");
+                exit(1);
+            }
+            std::string head;
+            std::string tail;
+            size_t received = 0;
+            ssize_t n;
+            while ((n = ::read(fd, buf.data(), buf.size())) > 0)
+            {
+                for (ssize_t i = 0; i < n;)
+                {
+                    if (received < headerLen)
+                    {
+                        head += buf[i];
+                        ++i;
+                        ++received;
+                    }
+                    else if (received < headerLen + size)
+                    { // 文件内容按段与参考数据比较
+                        size_t offset = received - headerLen;
+                        size_t len = std::min(static_cast<size_t>(n - i), headerLen + size - received);
+                        ok = ok && memcmp(buf.data() + i, reference.data() + offset % 251, len) == 0;
+                        i += len;
+                        received += len;
+                    }
+                    else
+                    {
+                        tail += buf[i];
+                        ++i;
+                        ++received;
+                    }
+                }
+            }
+            ::close(fd);
+            ok = ok && received == expected && head == kHeader && tail == kTrailer;
+        }
+        loop.runAfter(0.2, std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+    client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count() - 0.2;
+    double cpu = cpuSeconds() - cpuStart;
+    printf("%-10s %d x %zu MB: %8.3f s, %8.1f MB/s, process cpu %6.3f s%s\n", name, rounds, size >> 20, seconds,
+           rounds * (size >> 20) / seconds, cpu, ok ? "" : "  DATA MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    size_t size = static_cast<size_t>(argc > 1 ? atoi(argv[1]) : 64) << 20;
+    int rounds = argc > 2 ? atoi(argv[2]) : 4;
+    int fd = createFile(size);
+    runBench("read+send", false, fd, size, rounds);
+    runBench("sendFile", true, fd, size, rounds);
+    ::setenv("MUDUO_USE_IOURING", "1", 1);
+    runBench("uring-cqe", true, fd, size, rounds, true);
+    ::close(fd);
+}
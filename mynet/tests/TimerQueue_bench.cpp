@@ -0,0 +1,108 @@
+/**
+ * 大量未到期定时器下 std::set实现的定时器队列 与 分层时间轮(MUDUO_USE_TIMING_WHEEL) 的对比
+ * 都在loop线程中直接调用 不经过任务队列
+ * add:    添加N个1~60秒之后到期的定时器
+ * rearm:  对随机的定时器cancel + runAfter N次(每个连接的空闲超时在收到消息时重新计时)
+ * extend: 同样的重新计时改用extendTimer推迟N次(RestartableTimer的做法)
+ * cancel: 取消全部定时器
+ * expire: 添加N个在同一个100ms窗口内到期的定时器 统计从第一个到最后一个回调的时间 以及timerfd唤醒了几次
+ * 用法: TimerQueue_bench [定时器个数] [expire阶段每个定时器的slack毫秒数]
+ */
+#include "mynet/EventLoop.h"
+#include "base/Logger.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void runBench(const char *name, int count, double slack)
+{
+    EventLoop loop;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> delay(1.0, 60.0);
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    std::vector<TimerId> ids;
+    ids.reserve(count);
+
+    auto start = Clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        ids.push_back(loop.runAfter(delay(rng), []() {}));
+    }
+    double addMs = millisecondsSince(start);
+
+    start = Clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        int k = pick(rng);
+        loop.cancel(ids[k]);
+        ids[k] = loop.runAfter(delay(rng), []() {});
+    }
+    double rearmMs = millisecondsSince(start);
+
+    std::uniform_real_distribution<double> later(60.0, 120.0);
+    start = Clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        loop.extendTimer(ids[pick(rng)], addTime(MonoTimestamp::now(), later(rng)));
+    }
+    double extendMs = millisecondsSince(start);
+
+    start = Clock::now();
+    for (const TimerId &id : ids)
+    {
+        loop.cancel(id);
+    }
+    double cancelMs = millisecondsSince(start);
+
+    int fired = 0;
+    int wakeups = 0;
+    Timestamp lastWakeup;
+    Clock::time_point firstFired;
+    double expireMs = 0;
+    std::uniform_real_distribution<double> window(0.2, 0.3);
+    for (int i = 0; i < count; ++i)
+    {
+        loop.runAfter(window(rng), [&]()
+        {
+            if (loop.pollReturnTime() != lastWakeup)
+            { // 同一次poll返回处理的定时器算一次唤醒
+                lastWakeup = loop.pollReturnTime();
+                ++wakeups;
+            }
+            if (fired++ == 0)
+            {
+                firstFired = Clock::now();
+            }
+            if (fired == count)
+            {
+                expireMs = millisecondsSince(firstFired);
+                loop.quit();
+            }
+        }, slack);
+    }
+    loop.loop();
+
+    printf("%-12s %8d timers: add %8.1f ms, rearm %8.1f ms, extend %8.1f ms, cancel %8.1f ms, expire %8.1f ms"
+           " (%d wakeups)\n", name, count, addMs, rearmMs, extendMs, cancelMs, expireMs, wakeups);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+    double slack = argc > 2 ? atof(argv[2]) / 1000 : 0.0;
+    ::unsetenv("MUDUO_USE_TIMING_WHEEL");
+    runBench("std::set", count, slack);
+    ::setenv("MUDUO_USE_TIMING_WHEEL", "1", 1);
+    runBench("TimingWheel", count, slack);
+}
@@ -0,0 +1,102 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "mynet/EventLoop.h"
+#include "base/MonoTimestamp.h"
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+using namespace std;
+
+// 定时器的组织方式在EventLoop构造时按环境变量选择
+struct UseTimingWheel
+{
+    UseTimingWheel() { ::setenv("MUDUO_USE_TIMING_WHEEL", "1", 1); }
+};
+static UseTimingWheel useTimingWheel;
+
+struct Fired
+{
+    int delayMs;
+    MonoTimestamp deadline;
+    MonoTimestamp firedAt;
+};
+
+TEST_CASE("testTimingWheelExpiryOrderAcrossLevels")
+{
+    EventLoop loop;
+    // 第0层只覆盖64个tick(ms) 第1层64*64=4096个tick: 这些延时分别落在第0、1、2层 到期前要经过一次或两次cascade
+    const int delaysMs[] = {300, 5, 70, 4200, 63, 64, 129, 4097, 1, 200, 65, 1000};
+    const int count = sizeof delaysMs / sizeof delaysMs[0];
+    vector<Fired> fired;
+    MonoTimestamp start = MonoTimestamp::now();
+    for (int delay : delaysMs)
+    {
+        MonoTimestamp deadline = addTime(start, delay / 1000.0);
+        loop.runAt(deadline, [&, delay, deadline]()
+                   {
+                       fired.push_back(Fired{delay, deadline, MonoTimestamp::now()});
+                       if (static_cast<int>(fired.size()) == count)
+                       {
+                           loop.quit();
+                       }
+                   });
+    }
+    loop.loop();
+
+    REQUIRE(fired.size() == static_cast<size_t>(count));
+    vector<int> sorted(delaysMs, delaysMs + count);
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < count; ++i)
+    {
+        REQUIRE(fired[i].delayMs == sorted[i]);
+        REQUIRE(fired[i].firedAt >= fired[i].deadline); // 最多晚一个tick 不会提前
+    }
+}
+
+TEST_CASE("testTimingWheelCancelAndExtendAcrossLevels")
+{
+    EventLoop loop;
+    vector<int> fired;
+    MonoTimestamp start = MonoTimestamp::now();
+    // 150ms在第1层 取消时还没有cascade到第0层
+    TimerId canceled = loop.runAt(addTime(start, 0.15), [&]() { fired.push_back(150); });
+    // 80ms推迟到220ms: 从第1层的一个槽移到另一个槽
+    TimerId extended = loop.runAt(addTime(start, 0.08), [&]() { fired.push_back(220); });
+    loop.runAt(addTime(start, 0.02), [&]()
+               {
+                   fired.push_back(20);
+                   loop.cancel(canceled);
+                   loop.extendTimer(extended, addTime(start, 0.22));
+               });
+    loop.runAt(addTime(start, 0.1), [&]() { fired.push_back(100); });
+    loop.runAt(addTime(start, 0.3), [&]()
+               {
+                   fired.push_back(300);
+                   loop.quit();
+               });
+    loop.loop();
+
+    REQUIRE(fired == vector<int>({20, 100, 220, 300}));
+}
+
+TEST_CASE("testTimingWheelRepeatingTimer")
+{
+    EventLoop loop;
+    vector<MonoTimestamp> ticks;
+    MonoTimestamp start = MonoTimestamp::now();
+    // 每次重启都重新放置 周期跨过第0层的边界
+    TimerId timer = loop.runEvery(0.05, [&]() { ticks.push_back(MonoTimestamp::now()); });
+    loop.runAfter(0.27, [&]()
+                  {
+                      loop.cancel(timer);
+                      loop.quit();
+                  });
+    loop.loop();
+
+    REQUIRE(ticks.size() == 5);
+    for (size_t i = 0; i < ticks.size(); ++i)
+    {
+        REQUIRE(ticks[i] >= addTime(start, 0.05 * (i + 1)));
+    }
+}
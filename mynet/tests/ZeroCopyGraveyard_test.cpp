@@ -0,0 +1,106 @@
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/ZeroCopyGraveyard.h"
+#include "base/Logger.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+using namespace std;
+
+const uint16_t kPort = 2098;
+const size_t kPayload = 8 * 1024 * 1024;
+
+string makePayload()
+{
+    string payload(kPayload, '\0');
+    for (size_t i = 0; i < kPayload; ++i)
+    {
+        payload[i] = static_cast<char>(i % 251);
+    }
+    return payload;
+}
+
+// 在loop线程中取graveyard里的连接数
+size_t gravesOf(EventLoop *loop)
+{
+    std::promise<size_t> result;
+    loop->runInLoop([&]() { result.set_value(loop->zeroCopyGraveyard()->size()); });
+    return result.get_future().get();
+}
+
+TEST_CASE("testZeroCopyMemoryOutlivesConnection")
+{
+    Logger::setLogLevel(Logger::WARN);
+    const string expected = makePayload();
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "graveyard");
+    server.setZeroCopyThreshold(64 * 1024);
+    std::atomic<bool> zeroCopy(false);
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     { // 对端不读 大部分数据停在发送队列里 这时销毁连接 内存必须等到确认之后才释放
+                                         zeroCopy = conn->zeroCopy();
+                                         conn->send(string(expected));
+                                         conn->forceClose();
+                                     }
+                                 });
+    server.start();
+
+    size_t gravesAfterClose = 0;
+    size_t gravesAfterRead = 0;
+    string received;
+    std::thread client([&]()
+                       {
+                           sockaddr_in addr;
+                           memset(&addr, 0, sizeof addr);
+                           addr.sin_family = AF_INET;
+                           addr.sin_port = htons(kPort);
+                           addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                           int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                           int rcvbuf = 64 * 1024; // 接收窗口小一些 发送端一定有没确认的数据
+                           ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+                           if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) == 0)
+                           {
+                               std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                               gravesAfterClose = gravesOf(&loop);
+                               char buf[64 * 1024];
+                               ssize_t n;
+                               while ((n = ::read(fd, buf, sizeof buf)) > 0) // 读到graveyard替连接发出的FIN
+                               {
+                                   received.append(buf, n);
+                               }
+                               std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(ZeroCopyGraveyard::kCheckInterval * 3000)));
+                               gravesAfterRead = gravesOf(&loop);
+                           }
+                           ::close(fd);
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+
+    // 连接销毁之后发出去的字节仍然是原来的内容
+    REQUIRE(received.size() > 0);
+    REQUIRE(received.size() <= expected.size());
+    REQUIRE(received == expected.substr(0, received.size()));
+    if (zeroCopy)
+    {
+        REQUIRE(gravesAfterClose == 1);
+        REQUIRE(gravesAfterRead == 0);
+    }
+    else
+    {
+        WARN("SO_ZEROCOPY not supported, graveyard not exercised");
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * 大消息发送: 普通send(拷贝进内核) 与 MSG_ZEROCOPY(内核直接引用用户内存 完成通知从错误队列返回)
+ * 服务端每条消息都移交一个std::string给连接 写完成回调里再发下一批 客户端读到对端关闭并校验内容
+ * 统计吞吐量和整个进程消耗的CPU时间 以及完成通知中内核实际拷贝了的次数
+ * 注意: loopback上内核总是退回拷贝(SO_EE_CODE_ZEROCOPY_COPIED) 真正的收益要在物理网卡上才能看到
+ * 用法: ZeroCopy_bench [每种大小发送的总MB数]
+ */
+#include "mynet/TcpServer.h"
+#include "mynet/EventLoop.h"
+#include "mynet/InetAddress.h"
+#include "mynet/SocketsOps.h"
+#include "base/Logger.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+const uint16_t kPort = 2020;
+const int kBatch = 4; // 每次写完成之后一次排队的消息数
+
+typedef std::chrono::steady_clock Clock;
+
+double cpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void runBench(size_t msgSize, size_t totalBytes, bool zeroCopy)
+{
+    EventLoop loop;
+    InetAddress listenAddr(kPort, true);
+    TcpServer server(&loop, listenAddr, "ZeroCopy_bench");
+    server.setZeroCopyThreshold(zeroCopy ? 64 * 1024 : 0);
+
+    const int messages = static_cast<int>(std::max<size_t>(totalBytes / msgSize, 1));
+    const std::string payload(msgSize, 'z');
+    int sent = 0;
+    bool enabled = false;
+    uint64_t completions = 0;
+    uint64_t copied = 0;
+    bool sending = false;
+    bool again = false;
+    auto sendBatch = [&](const TcpConnectionPtr &conn)
+    {
+        if (sending)
+        { // 数据直接写完时写完成回调是同步调用的 会重入这里 留给外层循环再发一批
+            again = true;
+            return;
+        }
+        sending = true;
+        do
+        {
+            again = false;
+            for (int i = 0; i < kBatch && sent < messages; ++i, ++sent)
+            {
+                std::string message(payload);
+                message[0] = static_cast<char>('A' + sent % 26); // 每条消息的首字节不同 客户端据此校验顺序
+                conn->send(std::move(message));
+            }
+        } while (again && sent < messages);
+        sending = false;
+        if (sent == messages)
+        {
+            conn->shutdown();
+        }
+    };
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            enabled = conn->zeroCopy();
+            sendBatch(conn);
+        }
+        else
+        {
+            completions = conn->zeroCopyCompletions();
+            copied = conn->zeroCopyCopied();
+        }
+    });
+    server.setWriteCompleteCallback([&](const TcpConnectionPtr &conn)
+    {
+        if (sent < messages)
+        {
+            sendBatch(conn);
+        }
+    });
+    server.start();
+
+    bool ok = true;
+    double cpuStart = cpuSeconds();
+    auto start = Clock::now();
+    std::thread client([&]()
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        sockaddr_in addr;
+        bzero(&addr, sizeof addr);
+        sockets::fromIpPort("127.0.0.1", kPort, &addr);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        std::vector<char> buf(256 * 1024);
+        size_t received = 0;
+        ssize_t n;
+        while ((n = ::read(fd, buf.data(), buf.size())) > 0)
+        {
+            for (ssize_t i = 0; i < n;)
+            { // 只逐字节检查每条消息的首字节 其余部分整段比较
+                size_t offset = received % msgSize;
+                if (offset == 0)
+                {
+                    ok = ok && buf[i] == static_cast<char>('A' + received / msgSize % 26);
+                    ++i;
+                    ++received;
+                    continue;
+                }
+                size_t len = std::min(static_cast<size_t>(n - i), msgSize - offset);
+                ok = ok && memcmp(buf.data() + i, payload.data() + offset, len) == 0;
+                i += len;
+                received += len;
+            }
+        }
+        ::close(fd);
+        ok = ok && received == static_cast<size_t>(messages) * msgSize;
+        loop.runAfter(0.2, std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+    client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count() - 0.2;
+    double cpu = cpuSeconds() - cpuStart;
+    printf("%-8s %5zu KB x %5d: %8.3f s, %8.1f MB/s, process cpu %6.3f s", zeroCopy ? (enabled ? "zerocopy" : "(n/a)") : "copy",
+           msgSize >> 10, messages, seconds, messages * (msgSize / (1024.0 * 1024)) / seconds, cpu);
+    if (enabled)
+    {
+        printf(", completions %llu (kernel copied %llu)", static_cast<unsigned long long>(completions),
+               static_cast<unsigned long long>(copied));
+    }
+    printf("%s\n", ok ? "" : "  DATA MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    size_t totalBytes = static_cast<size_t>(argc > 1 ? atoi(argv[1]) : 512) << 20;
+    const size_t sizes[] = {64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    for (size_t size : sizes)
+    {
+        runBench(size, totalBytes, false);
+        runBench(size, totalBytes, true);
+    }
+}
@@ -0,0 +1,15 @@
+#include "mynet/TimerQueue.h"
+#include "mynet/timer/SetTimerQueue.h"
+#include "mynet/timer/TimingWheel.h"
+#include <stdlib.h>
+
+// 通过环境变量选择定时器的组织方式 默认为std::set
+// MUDUO_USE_TIMING_WHEEL -> 分层时间轮 大量定时器频繁添加/取消(例如每个连接的空闲超时)时使用
+TimerQueue *TimerQueue::newDefaultTimerQueue(EventLoop *loop)
+{
+    if (::getenv("MUDUO_USE_TIMING_WHEEL"))
+    {
+        return new TimingWheel(loop);
+    }
+    return new SetTimerQueue(loop);
+}
@@ -0,0 +1,159 @@
+#include "mynet/timer/SetTimerQueue.h"
+#include "base/Logger.h"
+#include "mynet/EventLoop.h"
+#include "mynet/Timer.h"
+#include "mynet/TimerId.h"
+#include <base/MonoTimestamp.h>
+#include <algorithm>
+#include <assert.h>
+
+SetTimerQueue::SetTimerQueue(EventLoop *loop) : TimerQueue(loop),
+                                                timers_(TimerList::allocator_type(&nodes_)),
+                                                activeTimers_(ActiveTimerSet::allocator_type(&nodes_)),
+                                                callingExpiredTimers_(false),
+                                                cancelingTimers_(ActiveTimerSet::allocator_type(&nodes_))
+{
+}
+
+SetTimerQueue::~SetTimerQueue() = default; // Timer对象都归timerPool_所有
+
+void SetTimerQueue::addTimerInLoop(Timer *timer)
+{
+    loop_->assertInLoopThread();
+    insert(timer);
+    // 新定时器的deadline早于timerfd已经设置的时刻才需要重设 有slack时相近的定时器共用一次设置
+    armTimerfd(timer->deadline());
+}
+
+void SetTimerQueue::cancelInLoop(TimerId timerId)
+{
+    loop_->assertInLoopThread();
+    assert(timers_.size() == activeTimers_.size());
+    ActiveTimer timer(timerOf(timerId), sequenceOf(timerId));
+    ActiveTimerSet::iterator it = activeTimers_.find(timer);
+    if (it != activeTimers_.end()) //能找到 
+    {
+        int n = timers_.erase(Entry(it->first->expiration(), it->first));
+        assert(n == 1);
+        timerPool_.release(it->first);
+        activeTimers_.erase(it);
+    }
+    else if (callingExpiredTimers_)
+    {   //已经到期 并且正则调用回调函数
+        cancelingTimers_.insert(timer); //插入cancelingTimers_ reset时会判断不需要再重启了
+    }
+    assert(timers_.size() == activeTimers_.size());
+}
+
+void SetTimerQueue::rescheduleInLoop(Timer *timer, MonoTimestamp when)
+{
+    ActiveTimerSet::iterator it = activeTimers_.find(ActiveTimer(timer, timer->sequence()));
+    if (it == activeTimers_.end())
+    {
+        return; // 正在运行回调
+    }
+    size_t n = timers_.erase(Entry(timer->expiration(), timer));
+    assert(n == 1); (void)n;
+    activeTimers_.erase(it);
+    timer->reschedule(when);
+    insert(timer);
+    armTimerfd(timer->deadline());
+}
+
+void SetTimerQueue::handleExpired(MonoTimestamp now)
+{
+    std::vector<Entry> expired = getExpired(now); // 获得该时刻之前的 所有的定时器列表（即超时定时器列表）
+    // extend()推迟过的定时器 新的时刻还没到 按新的时刻放回去 不运行
+    expired.erase(std::remove_if(expired.begin(), expired.end(),
+                                 [this, now](const Entry &entry)
+                                 {
+                                     if (!entry.second->postponed(now))
+                                     {
+                                         return false;
+                                     }
+                                     insert(entry.second);
+                                     return true;
+                                 }),
+                  expired.end());
+    //只关注了第一个定时器超时 但是可能会有很多定时器超时
+    callingExpiredTimers_ = true; //处理超时的定时器
+    cancelingTimers_.clear();
+    for (const auto &it : expired)//调用所有超时定时器的回调函数
+    {
+        it.second->run();
+    }
+    callingExpiredTimers_ = false;
+    reset(expired, now); //如果不是一次性定时器 需要重启
+}
+
+//为什么不返回引用类型 因为rvo的优化
+std::vector<SetTimerQueue::Entry> SetTimerQueue::getExpired(MonoTimestamp now)
+{
+    assert(timers_.size() == activeTimers_.size());
+    std::vector<Entry> expired;
+    Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+    TimerList::iterator end = timers_.lower_bound(sentry); //按时间排序的 返回第一个≥expired的位置 又由于sentry的pair的第二个参数地址是最大的 所以能确保lower_bound后 now < end->first
+    assert(end == timers_.end() || now < end->first);
+    std::copy(timers_.begin(), end, back_inserter(expired)); // 我们常常使用back_inserter来创建一个迭代器，作为算法的目的位置来使用 eg:fill_n(back_inserter(vec), 10, 0)
+    
+    timers_.erase(timers_.begin(), end);
+
+    for (const auto &it : expired) //从ActiverTimers中移除到期的定时器
+    {
+        ActiveTimer timer(it.second, it.second->sequence());
+        size_t n = activeTimers_.erase(timer);
+        assert(n == 1);
+    }
+
+    assert(timers_.size() == activeTimers_.size());
+    return expired;
+}
+
+void SetTimerQueue::reset(const std::vector<Entry> &expired, MonoTimestamp now)
+{
+    MonoTimestamp nextExpire;
+    for (const auto &it : expired)
+    {
+        ActiveTimer timer(it.second, it.second->sequence());
+        if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+        { // 是重复性计时器且还不在删除队列里
+            it.second->restart(now);
+            insert(it.second);
+        }else{
+            timerPool_.release(it.second); //回收进空闲链表 下次addTimer直接复用
+        }
+    }
+
+    // timerfd设置为剩下的定时器中最早的deadline 只需看到期时刻早于当前结果的那些: 之后的deadline不可能更早
+    for (const Entry &entry : timers_)
+    {
+        if (nextExpire.valid() && !(entry.first < nextExpire))
+        {
+            break;
+        }
+        MonoTimestamp deadline = entry.second->deadline();
+        if (!nextExpire.valid() || deadline < nextExpire)
+        {
+            nextExpire = deadline;
+        }
+    }
+    if(nextExpire.valid()){ // nextExpire.valid() 时间合法
+        armTimerfd(nextExpire);
+    }
+}
+
+void SetTimerQueue::insert(Timer *timer)
+{
+    loop_->assertInLoopThread();
+    assert(timers_.size() == activeTimers_.size());
+    MonoTimestamp when = timer->expiration();
+    {   //插入到timers_中
+        pair<TimerList::iterator,bool> result = timers_.insert(Entry(when,timer));
+        assert(result.second);
+    }
+    {   //插入到activeTimers中
+        pair<ActiveTimerSet::iterator,bool> result = activeTimers_.insert(ActiveTimer(timer,timer->sequence()));
+        assert(result.second);
+    }
+    assert(timers_.size() == activeTimers_.size());
+}
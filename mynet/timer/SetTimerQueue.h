@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <set>
+#include "base/FreeListAllocator.h"
+#include "mynet/TimerQueue.h"
+#include "atomic"
+
+/**
+ * 自定义的类若只给出了声明，没有给出定义。不完整类型必须通过某种方式补充完整，才能使用它们进行实例化，
+ * 否则只能用于定义指针或引用，因为此时实例化的是指针或引用本身，不是base或test对象。
+*/
+
+//原来的定时器队列: 按到期时间排序的std::set 插入/取消都是O(log n)
+class SetTimerQueue : public TimerQueue
+{
+private:
+//改进点是 这里Timer *用智能指针代替 unique_ptr
+    using Entry = std::pair<MonoTimestamp, Timer *>;
+    using TimerList = std::set<Entry, std::less<Entry>, FreeListAllocator<Entry>>; //用set是因为按时间排序 节点从nodes_中复用
+    using ActiveTimer = std::pair<Timer *, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer, std::less<ActiveTimer>, FreeListAllocator<ActiveTimer>>;
+
+    // move out all expired timers
+    std::vector<Entry> getExpired(MonoTimestamp now); //返回超时的定时器列表
+    void reset(const std::vector<Entry> &expired, MonoTimestamp now);//对超时的定时器重置 （如果是重复的定时器）
+
+    void insert(Timer *timer);
+
+    FreeList nodes_; // 两种set的节点大小相同 共用一个空闲链表 必须在set之前构造
+    TimerList timers_;//std::set<Entry>; 按到期时间排序
+    ActiveTimerSet activeTimers_;//ActiveTimerSet ; ActiveTimer = std::pair<Timer *, int64_t>; 按定时器地址排序
+    // for cancel
+
+    std::atomic<bool> callingExpiredTimers_; // 过期定时器
+    ActiveTimerSet cancelingTimers_;
+
+protected:
+    void addTimerInLoop(Timer *timer) override;
+    void cancelInLoop(TimerId timerId) override;
+    void rescheduleInLoop(Timer *timer, MonoTimestamp when) override;
+    void handleExpired(MonoTimestamp now) override;
+
+public:
+    explicit SetTimerQueue(EventLoop *loop);
+    ~SetTimerQueue() override;
+};
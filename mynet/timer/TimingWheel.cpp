@@ -0,0 +1,251 @@
+#include "mynet/timer/TimingWheel.h"
+#include "base/Logger.h"
+#include "mynet/EventLoop.h"
+#include <assert.h>
+
+const int TimingWheel::kBitsPerLevel;
+const int TimingWheel::kSlotsPerLevel;
+const int TimingWheel::kLevels;
+
+namespace
+{
+const int64_t kMicroSecondsPerTick = 1000;
+const int64_t kMaxDelta = (int64_t(1) << (TimingWheel::kBitsPerLevel * TimingWheel::kLevels)) - 1;
+
+// 循环右移: 结果的第i位是原来的第(pos + i) % 64位
+inline uint64_t rotateRight(uint64_t bits, int pos)
+{
+    return pos == 0 ? bits : (bits >> pos) | (bits << (64 - pos));
+}
+}
+
+TimingWheel::TimingWheel(EventLoop *loop)
+    : TimerQueue(loop),
+      currentTick_(tickOf(MonoTimestamp::now()))
+{
+    for (int level = 0; level < kLevels; ++level)
+    {
+        occupied_[level] = 0;
+        for (TimerHook &head : slots_[level])
+        {
+            head.prev = head.next = &head;
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() = default; // Timer对象都归timerPool_所有
+
+int64_t TimingWheel::tickOf(MonoTimestamp when)
+{
+    return (when.microSeconds() + kMicroSecondsPerTick - 1) / kMicroSecondsPerTick;
+}
+
+int64_t TimingWheel::slackTickOf(const Timer *timer)
+{
+    int64_t tick = tickOf(timer->expiration());
+    int64_t slackTicks = timer->slack() / kMicroSecondsPerTick;
+    if (slackTicks > 0)
+    { // 向上取整到不超过slack的2的幂的整数倍 slack相近的定时器落进同一个tick 一次唤醒一起处理
+        int64_t granularity = int64_t(1) << (63 - __builtin_clzll(static_cast<uint64_t>(slackTicks)));
+        tick = (tick + granularity - 1) & ~(granularity - 1);
+    }
+    return tick;
+}
+
+void TimingWheel::place(Timer *timer)
+{
+    int64_t tick = std::max(slackTickOf(timer), currentTick_); // 已经过期的放进当前tick的槽 下一次处理时触发
+    int64_t delta = tick - currentTick_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (int64_t(1) << (kBitsPerLevel * (level + 1))))
+    {
+        ++level;
+    }
+    if (delta > kMaxDelta)
+    { // 超出时间轮范围 先放在最高层最远的槽 cascade时按真实的到期时间重新放置
+        tick = currentTick_ + kMaxDelta;
+    }
+    int slot = static_cast<int>((tick >> (kBitsPerLevel * level)) & (kSlotsPerLevel - 1));
+    TimerHook &head = slots_[level][slot];
+    timer->prev = head.prev;
+    timer->next = &head;
+    head.prev->next = timer;
+    head.prev = timer;
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimingWheel::unlink(Timer *timer)
+{
+    TimerHook *prev = timer->prev;
+    TimerHook *next = timer->next;
+    prev->next = next;
+    next->prev = prev;
+    timer->prev = timer->next = nullptr;
+    if (prev == next)
+    { // 只剩哨兵 槽空了 由哨兵的地址算出是哪一层哪一个槽
+        ptrdiff_t index = prev - &slots_[0][0];
+        occupied_[index / kSlotsPerLevel] &= ~(uint64_t(1) << (index % kSlotsPerLevel));
+    }
+}
+
+void TimingWheel::cascade(int level, int slot)
+{
+    TimerHook &head = slots_[level][slot];
+    TimerHook *node = head.next;
+    head.prev = head.next = &head; // 整个链表摘下来 逐个重新放置
+    occupied_[level] &= ~(uint64_t(1) << slot);
+    while (node != &head)
+    {
+        TimerHook *next = node->next;
+        Timer *timer = static_cast<Timer *>(node);
+        timer->prev = timer->next = nullptr;
+        place(timer);
+        node = next;
+    }
+}
+
+int64_t TimingWheel::nextEventTick() const
+{
+    int64_t next = -1;
+    if (occupied_[0])
+    { // 第0层: 从当前tick的槽开始 第一个非空槽就是下一个到期的tick
+        int pos = static_cast<int>(currentTick_ & (kSlotsPerLevel - 1));
+        next = currentTick_ + __builtin_ctzll(rotateRight(occupied_[0], pos));
+    }
+    for (int level = 1; level < kLevels; ++level)
+    {
+        if (!occupied_[level])
+        {
+            continue;
+        }
+        // 高层: 从currentTick_之后(含)的第一个桶起点开始找 起点之前的桶已经cascade过 最远是其后第63个桶
+        int shift = kBitsPerLevel * level;
+        int64_t bucket = (currentTick_ + (int64_t(1) << shift) - 1) >> shift;
+        int pos = static_cast<int>(bucket & (kSlotsPerLevel - 1));
+        int64_t tick = (bucket + __builtin_ctzll(rotateRight(occupied_[level], pos))) << shift;
+        if (next < 0 || tick < next)
+        {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+void TimingWheel::rearm()
+{
+    int64_t next = nextEventTick();
+    if (next >= 0)
+    { // 已经设置的时刻更早时不必重设 提前醒来时什么都不做 再按那时的情况重设
+        armTimerfd(MonoTimestamp(next * kMicroSecondsPerTick));
+    }
+}
+
+void TimingWheel::addTimerInLoop(Timer *timer)
+{
+    loop_->assertInLoopThread();
+    // 时间轮长时间没有事件时currentTick_会落后 用本轮的时间把它追上来(与其他回调共用一次读时钟)
+    // 否则新定时器按落后的currentTick_放得过高 要多经过几次cascade
+    int64_t pollTick = loop_->monoNow().microSeconds() / kMicroSecondsPerTick;
+    if (currentTick_ <= pollTick)
+    {
+        int64_t next = nextEventTick();
+        if (next < 0 || next > pollTick)
+        {
+            currentTick_ = pollTick + 1;
+        }
+    }
+    place(timer);
+    rearm();
+}
+
+void TimingWheel::cancelInLoop(TimerId timerId)
+{
+    loop_->assertInLoopThread();
+    Timer *timer = timerOf(timerId);
+    if (timer->sequence() != sequenceOf(timerId) || timer->canceled())
+    {
+        return; // 已经到期回收了(对象可能已被新的定时器复用 代数不同) 或者已经取消过
+    }
+    if (timer->linked())
+    {
+        unlink(timer);
+        timerPool_.release(timer);
+    }
+    else
+    { // 正在expired_中等待运行或者正在运行 只做标记 处理完之后不会重启 由handleExpired回收
+        timer->cancel();
+    }
+}
+
+void TimingWheel::rescheduleInLoop(Timer *timer, MonoTimestamp when)
+{
+    if (!timer->linked())
+    {
+        return; // 正在运行回调
+    }
+    unlink(timer);
+    timer->reschedule(when);
+    place(timer);
+    rearm();
+}
+
+void TimingWheel::handleExpired(MonoTimestamp now)
+{
+    const int64_t nowTick = now.microSeconds() / kMicroSecondsPerTick;
+    expired_.clear();
+    for (;;)
+    {
+        int64_t tick = nextEventTick();
+        if (tick < 0 || tick > nowTick)
+        {
+            break;
+        }
+        currentTick_ = tick;
+        for (int level = kLevels - 1; level > 0; --level)
+        { // 走到高层桶的起点 先把这个桶的定时器放到低层
+            int shift = kBitsPerLevel * level;
+            if ((tick & ((int64_t(1) << shift) - 1)) == 0)
+            {
+                cascade(level, static_cast<int>((tick >> shift) & (kSlotsPerLevel - 1)));
+            }
+        }
+        TimerHook &head = slots_[0][tick & (kSlotsPerLevel - 1)];
+        while (head.next != &head)
+        {
+            Timer *timer = static_cast<Timer *>(head.next);
+            unlink(timer);
+            if (timer->postponed(now))
+            { // extend()推迟过 新的tick在当前tick之后 不会放回正在处理的槽
+                place(timer);
+            }
+            else
+            {
+                expired_.push_back(timer);
+            }
+        }
+        currentTick_ = tick + 1;
+    }
+    if (currentTick_ <= nowTick)
+    {
+        currentTick_ = nowTick + 1;
+    }
+
+    for (Timer *timer : expired_)
+    {
+        timer->run();
+    }
+    for (Timer *timer : expired_)
+    {
+        if (timer->repeat() && !timer->canceled())
+        {
+            timer->restart(now);
+            place(timer);
+        }
+        else
+        {
+            timerPool_.release(timer);
+        }
+    }
+    expired_.clear();
+    rearm();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "mynet/TimerQueue.h"
+#include "mynet/Timer.h"
+
+/**
+ * 分层时间轮 精度1ms(一个tick) 每层64个槽 共6层 覆盖2^36ms(约两年) 更远的定时器先放在最高层 到时再重新放置
+ * 第0层的槽对应接下来64个tick中的某一个 第l层的一个槽对应64^l个tick
+ * 定时器通过Timer里的TimerHook挂在槽的双向链表上 插入和取消都是O(1)
+ * 时间走到第l层某个槽的起点时 把这个槽里的定时器按剩余时间重新放进低层(cascade) 到第0层的槽时整槽到期
+ * 每层用一个64位的位图记录哪些槽非空 可以直接跳到下一个有事件的tick 空闲时不用逐个tick推进
+ * timerfd只设置为下一个事件(到期或者cascade)的时刻 定时器最多晚1ms触发 不会提前
+ * 有slack的定时器放置时向上对齐到不超过slack的2的幂个tick 时刻相近的合并进同一个槽 一次唤醒
+ */
+class TimingWheel : public TimerQueue
+{
+public:
+    explicit TimingWheel(EventLoop *loop);
+    ~TimingWheel() override;
+
+    static const int kBitsPerLevel = 6;
+    static const int kSlotsPerLevel = 1 << kBitsPerLevel;
+    static const int kLevels = 6;
+
+protected:
+    void addTimerInLoop(Timer *timer) override;
+    void cancelInLoop(TimerId timerId) override;
+    void rescheduleInLoop(Timer *timer, MonoTimestamp when) override;
+    void handleExpired(MonoTimestamp now) override;
+
+private:
+    void place(Timer *timer); // 按到期tick放进对应的层和槽
+    void unlink(Timer *timer);
+    void cascade(int level, int slot); // 把一个槽里的定时器重新放置
+    int64_t nextEventTick() const;     // 下一个需要处理的tick(某个第0层槽到期或者某层的cascade) 没有定时器时返回-1
+    void rearm();                      // timerfd设置为nextEventTick()的时刻
+
+    static int64_t tickOf(MonoTimestamp when); // 向上取整 保证不会提前触发
+    static int64_t slackTickOf(const Timer *timer); // 定时器放置的tick 在slack范围内向粗粒度对齐
+
+    TimerHook slots_[kLevels][kSlotsPerLevel]; // 每个槽一个循环链表的哨兵
+    uint64_t occupied_[kLevels];               // 非空槽的位图
+    int64_t currentTick_;                      // 小于currentTick_的tick都已经处理过
+    // 本次到期的定时器 回调期间被cancel的只做标记 之后不再重启
+    // TimerId是否有效由Timer的代数判断(Timer由timerPool_复用 内存不会释放) 不需要额外的集合
+    std::vector<Timer *> expired_;
+};